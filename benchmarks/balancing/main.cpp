@@ -0,0 +1,128 @@
+// Tail latency with uneven message costs.
+//
+// Sends messages at a fixed rate to a set of actors, one message in
+// `slow_every` taking `slow_us` to handle and the rest nearly nothing. The
+// messages are spread round-robin over actors with mailboxes of their own,
+// then sent to a BalancingPool of as many members. Prints latency
+// percentiles, from send to handled, for each.
+//
+// usage: balancing [messages] [actors] [slow_every] [slow_us] [interval_us]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <protoactor/balancing_pool.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::mutex latencies_mutex;
+std::vector<std::int64_t> latencies;
+
+class Job : public Message
+{
+public:
+    Job(Clock::time_point sent, std::chrono::microseconds cost)
+        : sent{sent}
+        , cost{cost}
+    {
+    }
+
+    const Clock::time_point sent;
+    const std::chrono::microseconds cost;
+};
+
+class Worker : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (auto job = dynamic_cast<Job *>(context.message().get())) {
+            if (job->cost.count() > 0) {
+                std::this_thread::sleep_for(job->cost);
+            }
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - job->sent).count();
+            std::unique_lock<std::mutex> lock(latencies_mutex);
+            latencies.push_back(latency);
+        }
+    }
+};
+
+template <typename TSend>
+void run(const std::string &name, int messages, int slow_every, std::chrono::microseconds slow, std::chrono::microseconds interval, TSend &&send)
+{
+    {
+        std::unique_lock<std::mutex> lock(latencies_mutex);
+        latencies.clear();
+    }
+    auto next = Clock::now();
+    for (auto i = 0; i < messages; ++i) {
+        std::this_thread::sleep_until(next);
+        auto cost = i % slow_every == 0 ? slow : std::chrono::microseconds(0);
+        send(i, Message::UPtr{new Job(next, cost)});
+        next += interval;
+    }
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(latencies_mutex);
+            if (latencies.size() == static_cast<std::size_t>(messages)) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p / 100.0 * static_cast<double>(latencies.size())))];
+    };
+    std::cout << name << ',' << percentile(50) << ',' << percentile(99) << ',' << percentile(99.9) << ',' << latencies.back() << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto messages = argc > 1 ? std::atoi(argv[1]) : 20000;
+    auto actors = argc > 2 ? std::atoi(argv[2]) : 4;
+    auto slow_every = argc > 3 ? std::atoi(argv[3]) : 100;
+    auto slow = std::chrono::microseconds(argc > 4 ? std::atoi(argv[4]) : 5000);
+    auto interval = std::chrono::microseconds(argc > 5 ? std::atoi(argv[5]) : 50);
+
+    ThreadPoolDispatcher dispatcher(actors);
+    auto props = Actor::from_producer([]() { return std::make_unique<Worker>(); });
+    props->with_dispatcher(dispatcher);
+
+    std::cout << "routing,p50_us,p99_us,p999_us,max_us" << std::endl;
+
+    std::vector<std::unique_ptr<PID>> routees;
+    for (auto i = 0; i < actors; ++i) {
+        routees.push_back(Actor::spawn(*props));
+    }
+    run("round_robin", messages, slow_every, slow, interval, [&](int i, Message::UPtr message) {
+        routees[static_cast<std::size_t>(i % actors)]->tell(std::move(message));
+    });
+    for (auto &routee : routees) {
+        routee->stop();
+    }
+
+    BalancingPool pool(*props, static_cast<std::size_t>(actors));
+    run("balancing", messages, slow_every, slow, interval, [&](int, Message::UPtr message) {
+        pool.tell(std::move(message));
+    });
+    pool.stop();
+    return 0;
+}
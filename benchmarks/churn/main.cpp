@@ -0,0 +1,114 @@
+// Spawn/stop churn.
+//
+// Repeatedly spawns an actor with its first message, sends it a few more and
+// stops it, which removes it from the registry and hands its mailbox and
+// context back for reuse. Prints sustained throughput and memory once per
+// second; heap in use and the allocator's retained-but-free bytes should stay
+// flat over time.
+//
+// usage: churn [seconds] [messages_per_actor] [synchronous|thread_pool]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<std::uint64_t> stopped{0};
+
+class Work : public Message
+{
+};
+
+class ShortLivedActor : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        auto message = context.message();
+        if (dynamic_cast<Work *>(message.get())) {
+            ++received_;
+        } else if (dynamic_cast<StoppedMessage *>(message.get())) {
+            stopped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    int received_{0};
+};
+
+std::int64_t resident_bytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    std::int64_t size = 0;
+    std::int64_t resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+    auto messages = argc > 2 ? std::atoi(argv[2]) : 3;
+    std::string dispatcher_name = argc > 3 ? argv[3] : "synchronous";
+    const std::uint64_t window = 10000;
+
+    std::unique_ptr<ThreadPoolDispatcher> thread_pool;
+    IDispatcher *dispatcher = &Dispatchers::default_dispatcher();
+    if (dispatcher_name == "thread_pool") {
+        thread_pool = std::make_unique<ThreadPoolDispatcher>();
+        dispatcher = thread_pool.get();
+    }
+
+    auto props = Actor::from_producer([]() { return std::make_unique<ShortLivedActor>(); });
+    props->with_dispatcher(*dispatcher);
+
+    std::cout << "second,actors_per_second,rss_bytes,heap_in_use_bytes,heap_free_retained_bytes" << std::endl;
+    std::uint64_t spawned = 0;
+    auto start = Clock::now();
+    auto next_report = start + std::chrono::seconds(1);
+    std::uint64_t last_stopped = 0;
+    for (auto second = 1; second <= seconds;) {
+        while (spawned - stopped.load(std::memory_order_relaxed) >= window) {
+            std::this_thread::yield();
+        }
+        // The first message is queued at spawn, together with StartedMessage.
+        auto pid = messages > 0 ? Actor::spawn(*props, Message::UPtr{new Work}) : Actor::spawn(*props);
+        for (auto i = 1; i < messages; ++i) {
+            pid->tell<Work>();
+        }
+        pid->stop();
+        ++spawned;
+
+        if ((spawned & 0x3ff) == 0 && Clock::now() >= next_report) {
+            auto done = stopped.load(std::memory_order_relaxed);
+            auto info = mallinfo2();
+            std::cout << second << ',' << (done - last_stopped) << ',' << resident_bytes() << ','
+                      << info.uordblks << ',' << info.fordblks << std::endl;
+            last_stopped = done;
+            next_report += std::chrono::seconds(1);
+            ++second;
+        }
+    }
+    while (stopped.load() < spawned) {
+        std::this_thread::yield();
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+// Integer codecs against Protobuf.
+//
+// Encodes and decodes a batch of integer-heavy telemetry records (a sensor
+// id, a timestamp and a run of samples, most of them small) with Protobuf and
+// with the codecs in protoactor/codec.hpp, bulk and scalar. Prints encoded
+// bytes per record and samples per second for encoding and decoding.
+//
+// usage: codec [records] [samples_per_record] [rounds]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <protoactor/codec.hpp>
+#include <string>
+#include <vector>
+
+#include "telemetry.pb.h"
+
+using namespace protoactor::codec;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+class Record
+{
+public:
+    std::uint32_t sensor_id{0};
+    std::uint64_t timestamp{0};
+    std::vector<std::uint32_t> samples;
+};
+
+class Rng
+{
+public:
+    std::uint64_t next()
+    {
+        // splitmix64
+        state_ += 0x9e3779b97f4a7c15ull;
+        auto z = state_;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    std::uint64_t state_{42};
+};
+
+// 70% below 2^7, 25% below 2^14, 5% full width.
+std::vector<Record> make_records(std::size_t count, std::size_t samples)
+{
+    Rng rng;
+    std::vector<Record> records(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        records[i].sensor_id = static_cast<std::uint32_t>(rng.next() % 10000);
+        records[i].timestamp = 1700000000000000000ull + i * 1000000;
+        records[i].samples.resize(samples);
+        for (auto &sample : records[i].samples) {
+            auto kind = rng.next() % 100;
+            auto value = static_cast<std::uint32_t>(rng.next());
+            sample = kind < 70 ? value % 128 : kind < 95 ? value % 16384 : value;
+        }
+    }
+    return records;
+}
+
+// Header fields as varints, then the sample count and the samples.
+template <typename TEncode>
+std::uint8_t *encode_record(const Record &record, std::uint8_t *out, TEncode &&encode)
+{
+    out = Varint::encode(record.sensor_id, out);
+    out = Varint::encode(record.timestamp, out);
+    out = Varint::encode(record.samples.size(), out);
+    return encode(record.samples.data(), record.samples.size(), out);
+}
+
+template <typename TDecode>
+const std::uint8_t *decode_record(const std::uint8_t *in, const std::uint8_t *end, Record &record, TDecode &&decode)
+{
+    std::uint64_t sensor_id = 0;
+    std::uint64_t count = 0;
+    in = Varint::decode(in, end, sensor_id);
+    in = in ? Varint::decode(in, end, record.timestamp) : nullptr;
+    in = in ? Varint::decode(in, end, count) : nullptr;
+    if (!in) {
+        return nullptr;
+    }
+    record.sensor_id = static_cast<std::uint32_t>(sensor_id);
+    record.samples.resize(count);
+    return decode(in, end, record.samples.data(), record.samples.size());
+}
+
+void report(const std::string &name, std::size_t bytes, std::size_t records, std::size_t values, Clock::duration encoding, Clock::duration decoding)
+{
+    auto encode_seconds = std::chrono::duration<double>(encoding).count();
+    auto decode_seconds = std::chrono::duration<double>(decoding).count();
+    std::cout << name << ',' << static_cast<double>(bytes) / records << ','
+              << static_cast<std::uint64_t>(values / encode_seconds) << ','
+              << static_cast<std::uint64_t>(values / decode_seconds) << std::endl;
+}
+
+template <typename TEncode, typename TDecode>
+void bench_codec(const std::string &name, const std::vector<Record> &records, int rounds, std::size_t max_size, TEncode &&encode, TDecode &&decode)
+{
+    std::vector<std::uint8_t> buffer(records.size() * max_size);
+    std::uint8_t *end = buffer.data();
+    auto start = Clock::now();
+    for (auto round = 0; round < rounds; ++round) {
+        end = buffer.data();
+        for (auto &record : records) {
+            end = encode_record(record, end, encode);
+        }
+    }
+    auto encoding = Clock::now() - start;
+
+    Record decoded;
+    std::uint64_t checksum = 0;
+    start = Clock::now();
+    for (auto round = 0; round < rounds; ++round) {
+        const std::uint8_t *in = buffer.data();
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            in = decode_record(in, end, decoded, decode);
+            if (!in) {
+                std::cerr << name << ": decoding failed" << std::endl;
+                std::exit(1);
+            }
+            checksum += decoded.samples.back();
+        }
+    }
+    auto decoding = Clock::now() - start;
+    if (decoded.samples != records.back().samples) {
+        std::cerr << name << ": round trip mismatch (" << checksum << ')' << std::endl;
+        std::exit(1);
+    }
+    auto values = static_cast<std::size_t>(rounds) * records.size() * records.front().samples.size();
+    report(name, static_cast<std::size_t>(end - buffer.data()), records.size(), values, encoding, decoding);
+}
+
+void bench_protobuf(const std::vector<Record> &records, int rounds)
+{
+    std::vector<protoactor::benchmarks::Telemetry> messages(records.size());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        messages[i].set_sensor_id(records[i].sensor_id);
+        messages[i].set_timestamp(records[i].timestamp);
+        for (auto sample : records[i].samples) {
+            messages[i].add_samples(sample);
+        }
+    }
+    std::vector<std::string> encoded(records.size());
+    std::size_t bytes = 0;
+    auto start = Clock::now();
+    for (auto round = 0; round < rounds; ++round) {
+        bytes = 0;
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            messages[i].SerializeToString(&encoded[i]);
+            bytes += encoded[i].size();
+        }
+    }
+    auto encoding = Clock::now() - start;
+
+    protoactor::benchmarks::Telemetry decoded;
+    start = Clock::now();
+    for (auto round = 0; round < rounds; ++round) {
+        for (auto &data : encoded) {
+            if (!decoded.ParseFromString(data)) {
+                std::cerr << "protobuf: decoding failed" << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+    auto decoding = Clock::now() - start;
+    auto values = static_cast<std::size_t>(rounds) * records.size() * records.front().samples.size();
+    report("protobuf", bytes, records.size(), values, encoding, decoding);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto record_count = static_cast<std::size_t>(argc > 1 ? std::atoi(argv[1]) : 10000);
+    auto samples = static_cast<std::size_t>(argc > 2 ? std::atoi(argv[2]) : 64);
+    auto rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+    auto records = make_records(record_count, samples);
+    auto header_size = Varint::max_size(3);
+
+    std::cout << "codec,bytes_per_record,encoded_samples_per_second,decoded_samples_per_second" << std::endl;
+    bench_protobuf(records, rounds);
+    bench_codec("varint_scalar", records, rounds, header_size + Varint::max_size(samples), &Varint::encode_scalar, &Varint::decode_scalar);
+    bench_codec("varint", records, rounds, header_size + Varint::max_size(samples),
+                [](const std::uint32_t *values, std::size_t count, std::uint8_t *out) { return Varint::encode(values, count, out); },
+                [](const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count) { return Varint::decode(in, end, values, count); });
+    bench_codec("group_varint_scalar", records, rounds, header_size + GroupVarint::max_size(samples), &GroupVarint::encode, &GroupVarint::decode_scalar);
+    bench_codec("group_varint", records, rounds, header_size + GroupVarint::max_size(samples), &GroupVarint::encode, &GroupVarint::decode);
+    bench_codec("fixed32", records, rounds, header_size + FixedWidth::max_size<std::uint32_t>(samples), &FixedWidth::encode<std::uint32_t>, &FixedWidth::decode<std::uint32_t>);
+    return 0;
+}
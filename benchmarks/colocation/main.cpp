@@ -0,0 +1,144 @@
+// Co-location of chatty actor pairs.
+//
+// Spawns `pairs` pinger/ponger pairs on a ThreadPoolDispatcher, and each
+// pair bounces a message `round_trips` times with request()/respond(). Runs
+// once as spawned and once with sampled tells feeding a ColocationPlacement,
+// which pins each pair onto one worker after a warm-up round, and prints the
+// mean time per round for each.
+//
+// usage: colocation [pairs] [round_trips] [rounds] [workers]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/colocation.hpp>
+#include <protoactor/communication_graph.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<int> finished{0};
+
+class Ball : public Message
+{
+public:
+    explicit Ball(int remaining)
+        : remaining{remaining}
+    {
+    }
+
+    const int remaining;
+};
+
+class Ponger : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (auto ball = dynamic_cast<Ball *>(context.message().get())) {
+            context.respond<Ball>(ball->remaining);
+        }
+    }
+};
+
+class Pinger : public IActor
+{
+public:
+    explicit Pinger(PID ponger)
+        : ponger_{ponger}
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (auto ball = dynamic_cast<Ball *>(context.message().get())) {
+            if (ball->remaining == 0) {
+                finished.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            context.request<Ball>(ponger_, ball->remaining - 1);
+        }
+    }
+
+private:
+    PID ponger_;
+};
+
+std::int64_t play(const std::vector<std::unique_ptr<PID>> &pingers, int round_trips)
+{
+    finished.store(0);
+    auto start = Clock::now();
+    for (auto &pinger : pingers) {
+        pinger->tell<Ball>(round_trips);
+    }
+    while (finished.load(std::memory_order_relaxed) < static_cast<int>(pingers.size())) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+void run(const std::string &name, bool colocate, int pairs, int round_trips, int rounds, int workers)
+{
+    ThreadPoolDispatcher dispatcher(workers);
+    auto &graph = CommunicationGraph::instance();
+    graph.clear();
+    graph.set_sample_interval(colocate ? 64 : 0);
+    ColocationPlacement placement(dispatcher);
+
+    std::vector<std::unique_ptr<PID>> pongers;
+    std::vector<std::unique_ptr<PID>> pingers;
+    auto ponger_props = Actor::from_producer([]() { return std::make_unique<Ponger>(); });
+    ponger_props->with_dispatcher(dispatcher);
+    for (auto i = 0; i < pairs; ++i) {
+        pongers.push_back(Actor::spawn(*ponger_props));
+        auto &ponger = *pongers.back();
+        auto pinger_props = Actor::from_producer([&ponger]() { return std::make_unique<Pinger>(ponger); });
+        pinger_props->with_dispatcher(dispatcher);
+        pingers.push_back(Actor::spawn(*pinger_props));
+    }
+
+    play(pingers, round_trips);
+    if (colocate) {
+        placement.rebalance();
+    }
+    std::int64_t total_us = 0;
+    for (auto round = 0; round < rounds; ++round) {
+        total_us += play(pingers, round_trips);
+    }
+    std::cout << name << ',' << total_us / rounds << std::endl;
+
+    graph.set_sample_interval(0);
+    for (auto &pid : pingers) {
+        pid->stop();
+    }
+    for (auto &pid : pongers) {
+        pid->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto pairs = argc > 1 ? std::atoi(argv[1]) : 64;
+    auto round_trips = argc > 2 ? std::atoi(argv[2]) : 2000;
+    auto rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+    auto workers = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    std::cout << "placement,round_us" << std::endl;
+    run("as_spawned", false, pairs, round_trips, rounds, workers);
+    run("colocated", true, pairs, round_trips, rounds, workers);
+    return 0;
+}
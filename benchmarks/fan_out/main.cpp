@@ -0,0 +1,99 @@
+// Broadcast to many idle actors.
+//
+// Sends one message to each of `actors` idle actors, first scheduling every
+// mailbox on its own and then inside a ScheduleBatch, and waits until all
+// of them have handled it. Prints the time spent posting and the time until
+// the last actor is done, averaged over the rounds.
+//
+// usage: fan_out [actors] [rounds] [workers]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<int> received{0};
+
+class Ping : public Message
+{
+};
+
+class Listener : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Ping *>(context.message().get())) {
+            received.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+template <typename TBroadcast>
+void run(const std::string &name, int actors, int rounds, TBroadcast &&broadcast)
+{
+    std::int64_t post_ns = 0;
+    std::int64_t total_ns = 0;
+    for (auto round = 0; round < rounds; ++round) {
+        received.store(0);
+        auto start = Clock::now();
+        broadcast();
+        auto posted = Clock::now();
+        while (received.load(std::memory_order_relaxed) < actors) {
+            std::this_thread::yield();
+        }
+        auto done = Clock::now();
+        post_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(posted - start).count();
+        total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(done - start).count();
+    }
+    std::cout << name << ',' << post_ns / rounds / 1000 << ',' << total_ns / rounds / 1000 << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto actors = argc > 1 ? std::atoi(argv[1]) : 10000;
+    auto rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+    auto workers = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    ThreadPoolDispatcher dispatcher(workers);
+    auto props = Actor::from_producer([]() { return std::make_unique<Listener>(); });
+    props->with_dispatcher(dispatcher);
+    std::vector<std::unique_ptr<PID>> pids;
+    for (auto i = 0; i < actors; ++i) {
+        pids.push_back(Actor::spawn(*props));
+    }
+
+    std::cout << "scheduling,post_us,all_handled_us" << std::endl;
+    run("one_by_one", actors, rounds, [&]() {
+        for (auto &pid : pids) {
+            pid->tell<Ping>();
+        }
+    });
+    run("batch", actors, rounds, [&]() {
+        ScheduleBatch batch;
+        for (auto &pid : pids) {
+            pid->tell<Ping>();
+        }
+    });
+
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Future/Promise continuation cost.
+//
+// Attaches chains of `depth` continuations to a promise, run inline and on a
+// ThreadPoolDispatcher, combines `depth` dispatched futures with when_all and
+// when_any, and abandons promises under a blocked wait(). Prints the mean
+// time per continuation, per combined future or per abandoned wait, and
+// flags any wrong result.
+//
+// usage: future [depth] [rounds] [workers]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/future.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace protoactor;
+using namespace protoactor::mailbox;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+template <typename TRound>
+void run(const std::string &name, int operations, int rounds, TRound &&round)
+{
+    auto failures = 0;
+    auto start = Clock::now();
+    for (auto i = 0; i < rounds; ++i) {
+        if (!round()) {
+            ++failures;
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    std::cout << name << ',' << elapsed / rounds / operations;
+    if (failures) {
+        std::cout << ",failed " << failures << " of " << rounds;
+    }
+    std::cout << std::endl;
+}
+
+Future<std::int64_t> chain(Future<std::int64_t> future, int depth, IDispatcher *dispatcher)
+{
+    for (auto i = 0; i < depth; ++i) {
+        auto add = [](std::int64_t value) { return value + 1; };
+        future = dispatcher ? future.then(*dispatcher, add) : future.then(add);
+    }
+    return future;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto depth = argc > 1 ? std::atoi(argv[1]) : 1000;
+    auto rounds = argc > 2 ? std::atoi(argv[2]) : 100;
+    auto workers = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    ThreadPoolDispatcher dispatcher(workers);
+    std::cout << "operation,ns_per_operation" << std::endl;
+    run("inline_then", depth, rounds, [&]() {
+        Promise<std::int64_t> promise;
+        auto future = chain(promise.get_future(), depth, nullptr);
+        promise.set_value(0);
+        return future.get() == depth;
+    });
+    run("dispatched_then", depth, rounds, [&]() {
+        Promise<std::int64_t> promise;
+        auto future = chain(promise.get_future(), depth, &dispatcher);
+        promise.set_value(0);
+        return future.get() == depth;
+    });
+    run("when_all", depth, rounds, [&]() {
+        std::vector<Future<std::int64_t>> futures;
+        for (auto i = 0; i < depth; ++i) {
+            futures.push_back(chain(make_ready_future<std::int64_t>(i), 1, &dispatcher));
+        }
+        auto values = when_all(std::move(futures)).get();
+        for (auto i = 0; i < depth; ++i) {
+            if (values[static_cast<std::size_t>(i)] != i + 1) {
+                return false;
+            }
+        }
+        return static_cast<int>(values.size()) == depth;
+    });
+    run("when_any", depth, rounds, [&]() {
+        std::vector<Future<std::int64_t>> futures;
+        for (auto i = 0; i < depth; ++i) {
+            futures.push_back(chain(make_ready_future<std::int64_t>(i), 1, &dispatcher));
+        }
+        auto first = when_any(std::move(futures)).get();
+        return first.second == static_cast<std::int64_t>(first.first) + 1;
+    });
+    run("abandoned_wait", 1, rounds, [&]() {
+        std::unique_ptr<Promise<std::int64_t>> promise{new Promise<std::int64_t>};
+        auto future = chain(promise->get_future(), 1, &dispatcher);
+        std::thread abandon([&promise]() { promise.reset(); });
+        auto ready = future.wait();
+        abandon.join();
+        return !ready;
+    });
+    return 0;
+}
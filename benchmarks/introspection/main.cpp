@@ -0,0 +1,142 @@
+// Cost of runtime introspection.
+//
+// Spawns `actors` idle actors next to `pairs` pairs that keep bouncing a
+// message with request()/respond(). Measures the bounces per second for a
+// while without and then with a thread taking Introspection::snapshot() in a
+// loop, and prints the mean snapshot time, followed by the last snapshot.
+//
+// usage: introspection [actors] [pairs] [milliseconds] [workers]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/introspection.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic_bool playing{true};
+std::atomic<std::int64_t> bounces{0};
+
+class Ball : public Message
+{
+};
+
+class Idle : public IActor
+{
+public:
+    virtual void receive(const IContext &) override
+    {
+    }
+};
+
+class Ponger : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Ball *>(context.message().get())) {
+            context.respond<Ball>();
+        }
+    }
+};
+
+class Pinger : public IActor
+{
+public:
+    explicit Pinger(PID ponger)
+        : ponger_{ponger}
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Ball *>(context.message().get()) && playing.load(std::memory_order_relaxed)) {
+            bounces.fetch_add(1, std::memory_order_relaxed);
+            context.request<Ball>(ponger_);
+        }
+    }
+
+private:
+    PID ponger_;
+};
+
+std::int64_t bounces_per_second(std::chrono::milliseconds duration)
+{
+    auto before = bounces.load();
+    auto start = Clock::now();
+    std::this_thread::sleep_for(duration);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    return (bounces.load() - before) * 1000000 / elapsed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto actors = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto pairs = argc > 2 ? std::atoi(argv[2]) : 16;
+    auto duration = std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 1000);
+    auto workers = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    ThreadPoolDispatcher dispatcher(workers);
+    std::vector<std::unique_ptr<PID>> pids;
+    auto idle_props = Actor::from_producer([]() { return std::make_unique<Idle>(); });
+    idle_props->with_dispatcher(dispatcher);
+    for (auto i = 0; i < actors; ++i) {
+        pids.push_back(Actor::spawn(*idle_props));
+    }
+    auto ponger_props = Actor::from_producer([]() { return std::make_unique<Ponger>(); });
+    ponger_props->with_dispatcher(dispatcher);
+    std::vector<std::unique_ptr<PID>> pingers;
+    for (auto i = 0; i < pairs; ++i) {
+        pids.push_back(Actor::spawn(*ponger_props));
+        auto &ponger = *pids.back();
+        auto pinger_props = Actor::from_producer([&ponger]() { return std::make_unique<Pinger>(ponger); });
+        pinger_props->with_dispatcher(dispatcher);
+        pingers.push_back(Actor::spawn(*pinger_props));
+        pingers.back()->tell<Ball>();
+    }
+
+    std::cout << "snapshots,bounces_per_second,snapshot_us" << std::endl;
+    std::cout << "off," << bounces_per_second(duration) << ",0" << std::endl;
+
+    std::atomic_bool snapshotting{true};
+    std::int64_t snapshots = 0;
+    std::int64_t snapshot_us = 0;
+    RuntimeSnapshot last;
+    std::thread observer([&]() {
+        while (snapshotting.load()) {
+            auto start = Clock::now();
+            last = Introspection::snapshot(5);
+            snapshot_us += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            ++snapshots;
+        }
+    });
+    auto rate = bounces_per_second(duration);
+    snapshotting.store(false);
+    observer.join();
+    std::cout << "on," << rate << ',' << (snapshots ? snapshot_us / snapshots : 0) << std::endl;
+    Introspection::dump(std::cout, last);
+
+    playing.store(false);
+    for (auto &pid : pingers) {
+        pid->stop();
+    }
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+    return 0;
+}
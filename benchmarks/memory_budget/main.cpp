@@ -0,0 +1,169 @@
+// Mailbox memory under a global budget.
+//
+// Floods `actors` slow actors with `messages` messages of `payload_bytes`
+// each, faster than they can handle them, into BudgetedMailbox mailboxes:
+// once without a limit, then under a limit of `limit_kb` KiB, rejecting or
+// spilling to a FileSpillStore. Prints the time until every message was
+// handled or dropped, the peak of MemoryBudget::used() and what was
+// rejected, spilled and lost, and flags messages that went missing.
+//
+// usage: memory_budget [actors] [messages] [payload_bytes] [limit_kb] [work_us] [workers]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <protoactor/memory_budget.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<std::int64_t> handled{0};
+std::atomic<int> spill_files{0};
+
+class Payload : public Message
+{
+public:
+    explicit Payload(std::string data)
+        : data{std::move(data)}
+    {
+    }
+
+    const std::string data;
+};
+
+class Worker : public IActor
+{
+public:
+    explicit Worker(std::chrono::microseconds work)
+        : work_{work}
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Payload *>(context.message().get())) {
+            auto start = Clock::now();
+            while (Clock::now() - start < work_) {
+            }
+            handled.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::chrono::microseconds work_;
+};
+
+std::shared_ptr<IMailbox> make_mailbox(bool spill)
+{
+    if (!spill) {
+        return BudgetedMailbox::create();
+    }
+    auto path = "memory_budget_spill_" + std::to_string(spill_files.fetch_add(1));
+    return BudgetedMailbox::create(std::make_shared<FileSpillStore>(path, [](const Message &message) {
+        return static_cast<const Payload &>(message).data;
+    }, [](const std::string &data) {
+        return Message::UPtr{new Payload(data)};
+    }));
+}
+
+void run(const std::string &name, std::size_t limit, bool spill, int actors, int messages, int payload_bytes, int work_us, int workers)
+{
+    auto &budget = MemoryBudget::instance();
+    budget.set_limit(limit);
+    auto rejected = budget.rejected();
+    auto spilled = budget.spilled();
+    auto lost = budget.lost();
+    handled.store(0);
+
+    ThreadPoolDispatcher dispatcher(workers);
+    auto props = Actor::from_producer([work_us]() { return std::make_unique<Worker>(std::chrono::microseconds(work_us)); });
+    props->with_dispatcher(dispatcher);
+    props->with_mailbox([spill]() { return make_mailbox(spill); });
+    std::vector<std::unique_ptr<PID>> pids;
+    for (auto i = 0; i < actors; ++i) {
+        pids.push_back(Actor::spawn(*props));
+    }
+
+    std::atomic_bool sampling{true};
+    std::int64_t peak = 0;
+    std::thread sampler([&]() {
+        while (sampling.load()) {
+            peak = std::max(peak, budget.used());
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+
+    auto start = Clock::now();
+    std::string data(static_cast<std::size_t>(payload_bytes), 'x');
+    for (auto i = 0; i < messages; ++i) {
+        pids[static_cast<std::size_t>(i % actors)]->tell<Payload>(data);
+    }
+    auto dropped = [&]() {
+        return static_cast<std::int64_t>(budget.rejected() - rejected + budget.lost() - lost);
+    };
+    auto last_progress = Clock::now();
+    auto last_count = std::int64_t{0};
+    while (handled.load() + dropped() < messages) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        auto count = handled.load() + dropped();
+        if (count != last_count) {
+            last_count = count;
+            last_progress = Clock::now();
+        } else if (Clock::now() - last_progress > std::chrono::seconds(5)) {
+            break;
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    sampling.store(false);
+    sampler.join();
+
+    std::cout << name << ',' << elapsed << ',' << peak / 1024 << ',' << budget.rejected() - rejected << ','
+              << budget.spilled() - spilled << ',' << budget.lost() - lost;
+    auto missing = messages - handled.load() - dropped();
+    if (missing) {
+        std::cout << ",missing " << missing;
+    }
+    std::cout << std::endl;
+
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto actors = argc > 1 ? std::atoi(argv[1]) : 64;
+    auto messages = argc > 2 ? std::atoi(argv[2]) : 200000;
+    auto payload_bytes = argc > 3 ? std::atoi(argv[3]) : 256;
+    auto limit_kb = argc > 4 ? std::atoi(argv[4]) : 4096;
+    auto work_us = argc > 5 ? std::atoi(argv[5]) : 2;
+    auto workers = argc > 6 ? std::atoi(argv[6]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    MemoryBudget::instance().set_sizer([](const Message &message) {
+        auto payload = dynamic_cast<const Payload *>(&message);
+        return sizeof(Payload) + (payload ? payload->data.size() : 0);
+    });
+
+    std::cout << "mailbox,elapsed_ms,peak_used_kb,rejected,spilled,lost" << std::endl;
+    auto limit = static_cast<std::size_t>(limit_kb) * 1024;
+    run("unlimited", std::numeric_limits<std::size_t>::max() / 4, false, actors, messages, payload_bytes, work_us, workers);
+    run("reject", limit, false, actors, messages, payload_bytes, work_us, workers);
+    run("spill", limit, true, actors, messages, payload_bytes, work_us, workers);
+    return 0;
+}
@@ -0,0 +1,233 @@
+// Memory footprint of idle actors and queued messages.
+//
+// Heap usage is counted by replacing the global operator new/delete, so every
+// figure is exact for this process: "requested" is what the code asked for,
+// "usable" includes the allocator's rounding. RSS and malloc statistics are
+// reported alongside as a cross-check.
+//
+// usage: memory_footprint [actors] [messages]
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <protoactor/fair_mailbox.hpp>
+#include <protoactor/protoactor.hpp>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace protoactor;
+
+namespace
+{
+
+std::atomic<std::int64_t> requested_bytes{0};
+std::atomic<std::int64_t> usable_bytes{0};
+std::atomic<std::int64_t> live_allocations{0};
+
+class Usage
+{
+public:
+    static Usage now()
+    {
+        Usage usage;
+        usage.requested = requested_bytes.load();
+        usage.usable = usable_bytes.load();
+        usage.allocations = live_allocations.load();
+        usage.resident = read_resident();
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        usage.malloc_in_use = static_cast<std::int64_t>(mallinfo2().uordblks);
+#endif
+        return usage;
+    }
+
+    std::int64_t requested{0};
+    std::int64_t usable{0};
+    std::int64_t allocations{0};
+    std::int64_t resident{0};
+    std::int64_t malloc_in_use{0};
+
+private:
+    static std::int64_t read_resident()
+    {
+        std::ifstream statm("/proc/self/statm");
+        std::int64_t size = 0;
+        std::int64_t resident = 0;
+        statm >> size >> resident;
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+};
+
+void report(const std::string &name, const Usage &before, const Usage &after, std::int64_t count)
+{
+    auto per = [count](std::int64_t value) {
+        return static_cast<double>(value) / static_cast<double>(count);
+    };
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << per(after.requested - before.requested)
+              << std::setw(12) << per(after.usable - before.usable)
+              << std::setw(10) << per(after.allocations - before.allocations)
+              << std::setw(12) << per(after.malloc_in_use - before.malloc_in_use)
+              << std::setw(12) << per(after.resident - before.resident) << std::endl;
+}
+
+class Empty : public Message
+{
+};
+
+class IdleActor : public IActor
+{
+public:
+    virtual void receive(const IContext &) override
+    {
+    }
+};
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    auto p = std::malloc(size ? size : 1);
+    if (!p) {
+        PROTOACTOR_THROW(std::bad_alloc());
+    }
+    requested_bytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+    usable_bytes.fetch_add(static_cast<std::int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+    live_allocations.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p) {
+        usable_bytes.fetch_sub(static_cast<std::int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+        live_allocations.fetch_sub(1, std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void operator delete(void *p, std::size_t size) noexcept
+{
+    if (p) {
+        requested_bytes.fetch_sub(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+    }
+    operator delete(p);
+}
+
+int main(int argc, char *argv[])
+{
+    auto actors = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto messages = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+    std::cout << "per item over " << actors << " actors / " << messages << " messages (bytes)" << std::endl;
+    std::cout << std::left << std::setw(28) << "component" << std::right
+              << std::setw(12) << "requested" << std::setw(12) << "usable" << std::setw(10) << "allocs"
+              << std::setw(12) << "malloc" << std::setw(12) << "rss" << std::endl;
+
+    auto props = Actor::from_producer([]() { return std::make_unique<IdleActor>(); });
+
+    // Whole actors, as spawned by users.
+    std::vector<std::unique_ptr<PID>> pids;
+    pids.reserve(static_cast<std::size_t>(actors));
+    auto before = Usage::now();
+    for (auto i = 0; i < actors; ++i) {
+        pids.push_back(Actor::spawn(*props));
+    }
+    report("actor (Actor::spawn)", before, Usage::now(), actors);
+
+    // Spawned but never messaged, so the actor itself is never created.
+    auto lazy_props = Actor::from_producer([]() { return std::make_unique<IdleActor>(); });
+    lazy_props->with_lazy_incarnation();
+    std::vector<std::unique_ptr<PID>> lazy_pids;
+    lazy_pids.reserve(static_cast<std::size_t>(actors));
+    before = Usage::now();
+    for (auto i = 0; i < actors; ++i) {
+        lazy_pids.push_back(Actor::spawn(*lazy_props));
+    }
+    report("actor (lazy incarnation)", before, Usage::now(), actors);
+
+    // The same pieces one by one, each kept alive so that nothing is reused.
+    std::vector<std::unique_ptr<PID>> bare_pids;
+    bare_pids.reserve(static_cast<std::size_t>(actors));
+    auto pid_before = Usage::now();
+    before = pid_before;
+    for (auto i = 0; i < actors; ++i) {
+        bare_pids.push_back(std::make_unique<PID>("nonhost", ProcessRegistry::instance().next_id()));
+    }
+    auto pid_usage = Usage::now();
+    report("  pid (strings)", before, pid_usage, actors);
+
+    std::vector<std::shared_ptr<IMailbox>> mailboxes;
+    mailboxes.reserve(static_cast<std::size_t>(actors));
+    before = Usage::now();
+    for (auto i = 0; i < actors; ++i) {
+        mailboxes.push_back(UnboundedMailbox::create());
+    }
+    report("  mailbox", before, Usage::now(), actors);
+
+    std::vector<std::unique_ptr<Process>> processes;
+    processes.reserve(static_cast<std::size_t>(actors));
+    before = Usage::now();
+    for (auto i = 0; i < actors; ++i) {
+        processes.push_back(std::make_unique<LocalProcess>(mailboxes[static_cast<std::size_t>(i)]));
+    }
+    report("  process", before, Usage::now(), actors);
+
+    std::vector<std::unique_ptr<PID>> registered;
+    registered.reserve(static_cast<std::size_t>(actors));
+    before = Usage::now();
+    for (auto i = 0; i < actors; ++i) {
+        auto &pid = *bare_pids[static_cast<std::size_t>(i)];
+        registered.push_back(ProcessRegistry::instance().try_add(pid.id(), std::move(processes[static_cast<std::size_t>(i)])));
+    }
+    // try_add also returns a fresh PID; take the cost measured above out.
+    auto after = Usage::now();
+    after.requested -= pid_usage.requested - pid_before.requested;
+    after.usable -= pid_usage.usable - pid_before.usable;
+    after.allocations -= pid_usage.allocations - pid_before.allocations;
+    after.malloc_in_use -= pid_usage.malloc_in_use - pid_before.malloc_in_use;
+    after.resident -= pid_usage.resident - pid_before.resident;
+    report("  registry node", before, after, actors);
+
+    std::vector<std::shared_ptr<LocalContext>> contexts;
+    contexts.reserve(static_cast<std::size_t>(actors));
+    before = Usage::now();
+    for (auto i = 0; i < actors; ++i) {
+        contexts.push_back(std::make_shared<LocalContext>(props->producer(), nullptr, *bare_pids[static_cast<std::size_t>(i)]));
+    }
+    report("  context (with actor)", before, Usage::now(), actors);
+
+    // Queued messages: the message objects are allocated up front so only the
+    // queue's own cost per slot is counted.
+    std::vector<std::pair<std::string, std::function<std::unique_ptr<IMailboxQueue> ()>>> queues{
+        {"unbounded", []() { return std::make_unique<UnboundedMailboxQueue>(); }},
+        {"fair", []() { return std::make_unique<FairMailboxQueue>(); }},
+    };
+    for (auto &queue_type : queues) {
+        std::vector<Message::UPtr> payload;
+        payload.reserve(static_cast<std::size_t>(messages));
+        for (auto i = 0; i < messages; ++i) {
+            payload.emplace_back(new Empty);
+        }
+        auto queue = queue_type.second();
+        before = Usage::now();
+        for (auto &message : payload) {
+            queue->push(std::move(message));
+        }
+        report("queued message (" + queue_type.first + ")", before, Usage::now(), messages);
+    }
+
+    std::cout << std::endl << "sizeof: PID " << sizeof(PID) << ", LocalProcess " << sizeof(LocalProcess)
+              << ", DefaultMailbox " << sizeof(DefaultMailbox) << ", UnboundedMailboxQueue " << sizeof(UnboundedMailboxQueue)
+              << ", LocalContext " << sizeof(LocalContext) << std::endl;
+    return 0;
+}
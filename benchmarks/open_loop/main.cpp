@@ -0,0 +1,243 @@
+// Open-loop load generator.
+//
+// Messages are injected on a fixed schedule regardless of how fast the actors
+// drain them, and latency is measured from the intended send time rather than
+// the actual one, so queueing delay under overload is not hidden
+// (coordinated omission). Each run prints one CSV row per offered rate; plot
+// p99/p999 against achieved_rate per dispatcher/mailbox to find saturation.
+// Messages still queued after a 10 s grace period count as lost; the actors
+// are stopped and the sink has stopped before its histogram is read.
+//
+// usage: open_loop [duration_ms] [rate ...]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/fair_mailbox.hpp>
+#include <protoactor/memory_budget.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+static std::int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+class Histogram
+{
+public:
+    void record(std::int64_t value)
+    {
+        if (value < 0) {
+            value = 0;
+        }
+        ++counts_[index_of(static_cast<std::uint64_t>(value))];
+        ++total_;
+        max_ = std::max(max_, value);
+    }
+
+    std::int64_t percentile(double p) const
+    {
+        auto wanted = static_cast<std::uint64_t>(p / 100.0 * static_cast<double>(total_));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen > wanted) {
+                // The bucket's upper bound may lie above anything recorded.
+                return std::min(static_cast<std::int64_t>(upper_bound_of(i)), max_);
+            }
+        }
+        return max_;
+    }
+
+    std::int64_t max() const { return max_; }
+    std::uint64_t total() const { return total_; }
+
+private:
+    static const int sub_bits = 4;
+    static const int buckets = 64 << sub_bits;
+
+    static std::size_t index_of(std::uint64_t value)
+    {
+        if (value < (1u << sub_bits)) {
+            return static_cast<std::size_t>(value);
+        }
+        auto exponent = 63 - __builtin_clzll(value);
+        auto sub = (value >> (exponent - sub_bits)) & ((1u << sub_bits) - 1);
+        return static_cast<std::size_t>(((exponent - sub_bits + 1) << sub_bits) + sub);
+    }
+
+    static std::uint64_t upper_bound_of(std::size_t index)
+    {
+        if (index < (1u << sub_bits)) {
+            return index;
+        }
+        auto exponent = static_cast<int>(index >> sub_bits) + sub_bits - 1;
+        auto sub = index & ((1u << sub_bits) - 1);
+        return ((std::uint64_t{1} << sub_bits | sub) + 1) << (exponent - sub_bits);
+    }
+
+    std::array<std::uint64_t, buckets> counts_{};
+    std::uint64_t total_{0};
+    std::int64_t max_{0};
+};
+
+class Timed : public Message
+{
+public:
+    Timed(std::int64_t intended) : intended(intended) {}
+
+    std::int64_t intended;
+};
+
+class Results
+{
+public:
+    Histogram histogram;
+    std::atomic<std::uint64_t> received{0};
+    // Set once the sink has stopped, after which histogram is not written.
+    std::atomic<bool> stopped{false};
+};
+
+class SinkActor : public IActor
+{
+public:
+    SinkActor(const std::shared_ptr<Results> &results) : results_(results) {}
+
+    virtual void receive(const IContext &context) override
+    {
+        auto message = context.message();
+        if (auto t = dynamic_cast<Timed *>(message.get())) {
+            results_->histogram.record(now_ns() - t->intended);
+            results_->received.fetch_add(1, std::memory_order_release);
+        } else if (dynamic_cast<StoppedMessage *>(message.get())) {
+            results_->stopped.store(true, std::memory_order_release);
+        }
+    }
+
+private:
+    std::shared_ptr<Results> results_;
+};
+
+class ForwardActor : public IActor
+{
+public:
+    ForwardActor(const PID &next) : next_(next) {}
+
+    virtual void receive(const IContext &context) override
+    {
+        auto message = context.message();
+        if (auto t = dynamic_cast<Timed *>(message.get())) {
+            next_.tell<Timed>(t->intended);
+        }
+    }
+
+private:
+    PID next_;
+};
+
+class Setup
+{
+public:
+    std::string dispatcher_name;
+    IDispatcher *dispatcher;
+    std::string mailbox_name;
+    MailboxProducer mailbox;
+};
+
+static void run(const Setup &setup, const std::string &topology, int stages, double rate, std::chrono::milliseconds duration)
+{
+    auto results = std::make_shared<Results>();
+    auto &histogram = results->histogram;
+    auto &received = results->received;
+
+    auto sink_props = Actor::from_producer([results]() { return std::make_unique<SinkActor>(results); });
+    sink_props->with_dispatcher(*setup.dispatcher).with_mailbox(MailboxProducer{setup.mailbox});
+    std::vector<std::unique_ptr<PID>> pids;
+    pids.push_back(Actor::spawn(*sink_props));
+    for (auto i = 1; i < stages; ++i) {
+        PID next = *pids.back();
+        auto props = Actor::from_producer([next]() { return std::make_unique<ForwardActor>(next); });
+        props->with_dispatcher(*setup.dispatcher).with_mailbox(MailboxProducer{setup.mailbox});
+        pids.push_back(Actor::spawn(*props));
+    }
+    auto &entry = *pids.back();
+
+    auto interval = 1e9 / rate;
+    auto count = static_cast<std::uint64_t>(rate * std::chrono::duration<double>(duration).count());
+    auto start = now_ns();
+    for (std::uint64_t i = 0; i < count; ++i) {
+        auto intended = start + static_cast<std::int64_t>(static_cast<double>(i) * interval);
+        while (now_ns() < intended) {
+        }
+        entry.tell<Timed>(intended);
+    }
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (received.load(std::memory_order_acquire) < count && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = static_cast<double>(now_ns() - start) / 1e9;
+    auto done = received.load(std::memory_order_acquire);
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+    while (!results->stopped.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::cout << setup.dispatcher_name << ',' << setup.mailbox_name << ',' << topology << ','
+              << static_cast<std::uint64_t>(rate) << ',' << static_cast<std::uint64_t>(static_cast<double>(done) / elapsed) << ','
+              << histogram.percentile(50) << ',' << histogram.percentile(90) << ',' << histogram.percentile(99) << ','
+              << histogram.percentile(99.9) << ',' << histogram.max() << ',' << (count - done) << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::chrono::milliseconds duration{argc > 1 ? std::atoi(argv[1]) : 500};
+    std::vector<double> rates;
+    for (auto i = 2; i < argc; ++i) {
+        rates.push_back(std::atof(argv[i]));
+    }
+    if (rates.empty()) {
+        rates = {10000, 50000, 100000, 200000, 400000, 800000};
+    }
+
+    ThreadPoolDispatcher thread_pool;
+    std::vector<std::pair<std::string, IDispatcher *>> dispatchers{
+        {"synchronous", &Dispatchers::default_dispatcher()},
+        {"thread_pool", &thread_pool},
+    };
+    std::vector<std::pair<std::string, MailboxProducer>> mailboxes{
+        {"unbounded", []() { return UnboundedMailbox::create(); }},
+        {"fair", []() { return FairMailbox::create(); }},
+        {"budgeted", []() { return BudgetedMailbox::create(); }},
+    };
+    std::vector<Setup> setups;
+    for (auto &dispatcher : dispatchers) {
+        for (auto &mailbox : mailboxes) {
+            setups.push_back({dispatcher.first, dispatcher.second, mailbox.first, mailbox.second});
+        }
+    }
+
+    std::cout << "dispatcher,mailbox,topology,offered_rate,achieved_rate,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,lost" << std::endl;
+    for (auto &setup : setups) {
+        for (auto rate : rates) {
+            run(setup, "single", 1, rate, duration);
+            run(setup, "pipeline4", 4, rate, duration);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Request/response latency between two actors.
+//
+// Two actors on a ThreadPoolDispatcher bounce a message back and forth, each
+// replying with respond(), for a number of round trips. Prints the mean
+// round trip time and CPU time for each max_linger setting, so the latency
+// saved by lingering can be weighed against the CPU it burns.
+//
+// usage: ping_pong [round_trips] [workers] [max_linger ...]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic_bool finished{false};
+
+class Ball : public Message
+{
+public:
+    explicit Ball(int remaining)
+        : remaining{remaining}
+    {
+    }
+
+    const int remaining;
+};
+
+class Ponger : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (auto ball = dynamic_cast<Ball *>(context.message().get())) {
+            context.respond<Ball>(ball->remaining);
+        }
+    }
+};
+
+class Pinger : public IActor
+{
+public:
+    explicit Pinger(PID ponger)
+        : ponger_{ponger}
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (auto ball = dynamic_cast<Ball *>(context.message().get())) {
+            if (ball->remaining == 0) {
+                finished.store(true);
+                return;
+            }
+            context.request<Ball>(ponger_, ball->remaining - 1);
+        }
+    }
+
+private:
+    PID ponger_;
+};
+
+double cpu_seconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto round_trips = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto workers = argc > 2 ? std::atoi(argv[2]) : 2;
+    std::vector<int> lingers;
+    for (auto i = 3; i < argc; ++i) {
+        lingers.push_back(std::atoi(argv[i]));
+    }
+    if (lingers.empty()) {
+        lingers = {0, 256, 4096};
+    }
+
+    std::cout << "max_linger,round_trip_ns,cpu_ns_per_round_trip" << std::endl;
+    for (auto linger : lingers) {
+        ThreadPoolDispatcher dispatcher(workers, 300, linger);
+        auto ponger_props = Actor::from_producer([]() { return std::make_unique<Ponger>(); });
+        ponger_props->with_dispatcher(dispatcher);
+        auto ponger = Actor::spawn(*ponger_props);
+        auto pinger_props = Actor::from_producer([&ponger]() { return std::make_unique<Pinger>(*ponger); });
+        pinger_props->with_dispatcher(dispatcher);
+        auto pinger = Actor::spawn(*pinger_props);
+
+        finished.store(false);
+        auto cpu_start = cpu_seconds();
+        auto start = Clock::now();
+        pinger->tell<Ball>(round_trips);
+        while (!finished.load()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        auto cpu = (cpu_seconds() - cpu_start) * 1e9;
+        std::cout << linger << ',' << elapsed / round_trips << ',' << static_cast<std::int64_t>(cpu / round_trips) << std::endl;
+        pinger->stop();
+        ponger->stop();
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Latency of a coordinator actor next to saturating bulk actors.
+//
+// `bulk` actors keep the dispatcher busy, every message burning `work_us`
+// of CPU and sending the next one to self. A coordinator gets a message
+// every `interval_us` and records how long it waited. Runs once with the
+// coordinator at the bulk actors' priority and once at SchedulePriority::
+// High, and prints latency percentiles and the bulk throughput for each.
+//
+// usage: priority [duration_ms] [bulk] [work_us] [interval_us] [workers]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic_bool running{true};
+std::atomic<std::uint64_t> bulk_handled{0};
+std::mutex latencies_mutex;
+std::vector<std::int64_t> latencies;
+
+class Work : public Message
+{
+};
+
+class Tick : public Message
+{
+public:
+    explicit Tick(Clock::time_point sent)
+        : sent{sent}
+    {
+    }
+
+    const Clock::time_point sent;
+};
+
+class Bulk : public IActor
+{
+public:
+    explicit Bulk(std::chrono::microseconds work)
+        : work_{work}
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (!dynamic_cast<Work *>(context.message().get())) {
+            return;
+        }
+        auto until = Clock::now() + work_;
+        while (Clock::now() < until) {
+        }
+        bulk_handled.fetch_add(1, std::memory_order_relaxed);
+        if (running.load(std::memory_order_relaxed)) {
+            const_cast<PID &>(context.self()).tell<Work>();
+        }
+    }
+
+private:
+    std::chrono::microseconds work_;
+};
+
+class Coordinator : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (auto tick = dynamic_cast<Tick *>(context.message().get())) {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tick->sent).count();
+            std::unique_lock<std::mutex> lock(latencies_mutex);
+            latencies.push_back(latency);
+        }
+    }
+};
+
+void run(const std::string &name, SchedulePriority priority, std::chrono::milliseconds duration, int bulk, std::chrono::microseconds work, std::chrono::microseconds interval, int workers)
+{
+    running.store(true);
+    bulk_handled.store(0);
+    latencies.clear();
+    ThreadPoolDispatcher dispatcher(workers);
+    auto bulk_props = Actor::from_producer([work]() { return std::make_unique<Bulk>(work); });
+    bulk_props->with_dispatcher(dispatcher);
+    auto coordinator_props = Actor::from_producer([]() { return std::make_unique<Coordinator>(); });
+    coordinator_props->with_dispatcher(dispatcher).with_priority(priority);
+
+    std::vector<std::unique_ptr<PID>> pids;
+    for (auto i = 0; i < bulk; ++i) {
+        pids.push_back(Actor::spawn(*bulk_props));
+        pids.back()->tell<Work>();
+    }
+    auto coordinator = Actor::spawn(*coordinator_props);
+    auto end = Clock::now() + duration;
+    for (auto next = Clock::now(); next < end; next += interval) {
+        std::this_thread::sleep_until(next);
+        coordinator->tell<Tick>(Clock::now());
+    }
+    running.store(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::unique_lock<std::mutex> lock(latencies_mutex);
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(p / 100.0 * static_cast<double>(latencies.size())))];
+    };
+    std::cout << name << ',' << percentile(50) << ',' << percentile(99) << ',' << latencies.back() << ',' << bulk_handled.load() << std::endl;
+    lock.unlock();
+    coordinator->stop();
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto duration = std::chrono::milliseconds(argc > 1 ? std::atoi(argv[1]) : 1000);
+    auto bulk = argc > 2 ? std::atoi(argv[2]) : 64;
+    auto work = std::chrono::microseconds(argc > 3 ? std::atoi(argv[3]) : 50);
+    auto interval = std::chrono::microseconds(argc > 4 ? std::atoi(argv[4]) : 1000);
+    auto workers = argc > 5 ? std::atoi(argv[5]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    std::cout << "coordinator,p50_us,p99_us,max_us,bulk_handled" << std::endl;
+    run("normal", SchedulePriority::Normal, duration, bulk, work, interval, workers);
+    run("high", SchedulePriority::High, duration, bulk, work, interval, workers);
+    return 0;
+}
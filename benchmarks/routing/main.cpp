@@ -0,0 +1,139 @@
+// Consistent-hash routing of large batches.
+//
+// Hashes batches of keys with the scalar and the vectorized hash, then routes
+// the same batches to a set of routees one message at a time and with
+// ConsistentHashRouter's batch tell, waiting for every batch to be received.
+// Prints keys per second for each.
+//
+// usage: routing [batch_size] [batches] [routees]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/router.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<std::uint64_t> received{0};
+
+class Keyed : public Message
+{
+public:
+    explicit Keyed(std::uint64_t key)
+        : key{key}
+    {
+    }
+
+    const std::uint64_t key;
+};
+
+class Routee : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Keyed *>(context.message().get())) {
+            received.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+std::vector<std::uint64_t> make_keys(std::size_t count, std::uint64_t seed)
+{
+    std::vector<std::uint64_t> keys(count);
+    auto x = seed;
+    for (auto &key : keys) {
+        // splitmix64
+        x += 0x9e3779b97f4a7c15ull;
+        auto z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        key = z ^ (z >> 31);
+    }
+    return keys;
+}
+
+void report(const std::string &name, Clock::duration elapsed, std::uint64_t keys)
+{
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << name << ',' << static_cast<std::uint64_t>(keys / seconds) << std::endl;
+}
+
+template <typename THash>
+void bench_hash(const std::string &name, const std::vector<std::uint64_t> &keys, int batches, THash &&hash)
+{
+    std::vector<std::uint32_t> hashes(keys.size());
+    auto start = Clock::now();
+    for (auto i = 0; i < batches; ++i) {
+        hash(keys.data(), hashes.data(), keys.size());
+    }
+    report(name, Clock::now() - start, static_cast<std::uint64_t>(batches) * keys.size());
+}
+
+template <typename TSend>
+void bench_route(const std::string &name, const std::vector<std::uint64_t> &keys, int batches, TSend &&send)
+{
+    std::vector<Message::UPtr> messages(keys.size());
+    std::uint64_t expected = received.load();
+    auto start = Clock::now();
+    for (auto i = 0; i < batches; ++i) {
+        for (std::size_t k = 0; k < keys.size(); ++k) {
+            messages[k].reset(new Keyed(keys[k]));
+        }
+        send(messages);
+        expected += keys.size();
+        while (received.load(std::memory_order_relaxed) < expected) {
+            std::this_thread::yield();
+        }
+    }
+    report(name, Clock::now() - start, static_cast<std::uint64_t>(batches) * keys.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto batch_size = static_cast<std::size_t>(argc > 1 ? std::atoi(argv[1]) : 10000);
+    auto batches = argc > 2 ? std::atoi(argv[2]) : 200;
+    auto routee_count = argc > 3 ? std::atoi(argv[3]) : 16;
+
+    ThreadPoolDispatcher dispatcher;
+    auto props = Actor::from_producer([]() { return std::make_unique<Routee>(); });
+    props->with_dispatcher(dispatcher);
+    std::vector<PID> routees;
+    for (auto i = 0; i < routee_count; ++i) {
+        routees.push_back(*Actor::spawn(*props));
+    }
+    ConsistentHashRouter router(routees);
+    auto keys = make_keys(batch_size, 42);
+
+    std::cout << "case,keys_per_second" << std::endl;
+    bench_hash("hash_scalar", keys, batches, &ConsistentHashRouter::hash_keys_scalar);
+    bench_hash("hash_batch", keys, batches, &ConsistentHashRouter::hash_keys);
+    bench_route("route_per_message", keys, batches, [&](std::vector<Message::UPtr> &messages) {
+        for (std::size_t k = 0; k < keys.size(); ++k) {
+            router.tell(keys[k], std::move(messages[k]));
+        }
+    });
+    bench_route("route_batch", keys, batches, [&](std::vector<Message::UPtr> &messages) {
+        router.tell(keys.data(), messages.data(), keys.size());
+    });
+
+    for (auto &routee : routees) {
+        routee.stop();
+    }
+    return 0;
+}
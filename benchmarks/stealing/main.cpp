@@ -0,0 +1,146 @@
+// Work stealing from one loaded worker.
+//
+// A spreader actor tells each of `actors` actors to run through its `state_kb`
+// KiB of state; as the spreader's worker schedules them all, the other
+// workers only get them by stealing. Runs once with a flat pool and once
+// with workers pinned along CpuTopology::instance() and stealing from the
+// nearest first, and prints the average time per round for each.
+//
+// usage: stealing [actors] [state_kb] [rounds] [workers]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/cpu_topology.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<int> done{0};
+
+class Go : public Message
+{
+};
+
+class Touch : public Message
+{
+};
+
+class Toucher : public IActor
+{
+public:
+    explicit Toucher(std::size_t words)
+        : state_(words, 1)
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Touch *>(context.message().get())) {
+            for (auto &word : state_) {
+                word = word * 31 + 7;
+            }
+            done.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::vector<std::uint64_t> state_;
+};
+
+class Spreader : public IActor
+{
+public:
+    explicit Spreader(const std::vector<std::unique_ptr<PID>> &actors)
+        : actors_(actors)
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<Go *>(context.message().get())) {
+            for (auto &pid : actors_) {
+                pid->tell<Touch>();
+            }
+        }
+    }
+
+private:
+    const std::vector<std::unique_ptr<PID>> &actors_;
+};
+
+void run(const std::string &name, ThreadPoolDispatcher &dispatcher, int actors, std::size_t words, int rounds)
+{
+    std::vector<std::unique_ptr<PID>> pids;
+    auto props = Actor::from_producer([words]() { return std::make_unique<Toucher>(words); });
+    props->with_dispatcher(dispatcher);
+    for (auto i = 0; i < actors; ++i) {
+        pids.push_back(Actor::spawn(*props));
+    }
+    auto spreader_props = Actor::from_producer([&pids]() { return std::make_unique<Spreader>(pids); });
+    spreader_props->with_dispatcher(dispatcher);
+    auto spreader = Actor::spawn(*spreader_props);
+
+    std::int64_t total_ns = 0;
+    for (auto round = 0; round < rounds; ++round) {
+        done.store(0);
+        auto start = Clock::now();
+        spreader->tell<Go>();
+        while (done.load(std::memory_order_relaxed) < actors) {
+            std::this_thread::yield();
+        }
+        total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+    std::cout << name << ',' << total_ns / rounds / 1000 << std::endl;
+
+    spreader->stop();
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto actors = argc > 1 ? std::atoi(argv[1]) : 1000;
+    auto state_kb = argc > 2 ? std::atoi(argv[2]) : 64;
+    auto rounds = argc > 3 ? std::atoi(argv[3]) : 20;
+    auto workers = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+    auto words = static_cast<std::size_t>(state_kb) * 1024 / sizeof(std::uint64_t);
+
+    auto &topology = CpuTopology::instance();
+    std::set<int> cores;
+    std::set<int> caches;
+    std::set<int> sockets;
+    for (auto &cpu : topology.cpus()) {
+        cores.insert(cpu.core);
+        caches.insert(cpu.cache);
+        sockets.insert(cpu.socket);
+    }
+    std::cout << "# cpus " << topology.cpus().size() << ", cores " << cores.size() << ", caches " << caches.size() << ", sockets " << sockets.size() << std::endl;
+
+    std::cout << "stealing,round_us" << std::endl;
+    {
+        ThreadPoolDispatcher dispatcher(workers);
+        run("flat", dispatcher, actors, words, rounds);
+    }
+    {
+        ThreadPoolDispatcher dispatcher(workers, 300, 0, 8, &topology);
+        run("topology", dispatcher, actors, words, rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+// TaskGraph scheduling overhead.
+//
+// Builds graphs of `tasks` tiny tasks in three shapes - a chain, a fan-out
+// into a fan-in, and layers of `width` tasks where each task waits for two of
+// the layer before - runs each `rounds` times on a ThreadPoolDispatcher and
+// prints the mean time per task. Checks that every task ran once per round.
+//
+// usage: task_graph [tasks] [width] [rounds] [workers]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <protoactor/task_graph.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+
+using namespace protoactor;
+using namespace protoactor::mailbox;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<std::int64_t> executed{0};
+
+TaskGraph::TaskId add_task(TaskGraph &graph)
+{
+    return graph.add([]() { executed.fetch_add(1, std::memory_order_relaxed); });
+}
+
+void chain(TaskGraph &graph, int tasks, int)
+{
+    auto previous = add_task(graph);
+    for (auto i = 1; i < tasks; ++i) {
+        auto next = add_task(graph);
+        graph.precede(previous, next);
+        previous = next;
+    }
+}
+
+void fan(TaskGraph &graph, int tasks, int)
+{
+    auto source = add_task(graph);
+    auto sink = add_task(graph);
+    for (auto i = 2; i < tasks; ++i) {
+        auto middle = add_task(graph);
+        graph.precede(source, middle);
+        graph.precede(middle, sink);
+    }
+}
+
+void layers(TaskGraph &graph, int tasks, int width)
+{
+    width = std::max(width, 1);
+    for (auto i = 0; i < tasks; ++i) {
+        auto task = add_task(graph);
+        if (i >= width) {
+            auto column = i % width;
+            auto above = static_cast<TaskGraph::TaskId>(i - width - column);
+            graph.precede(above + static_cast<TaskGraph::TaskId>(column), task);
+            graph.precede(above + static_cast<TaskGraph::TaskId>((column + 1) % width), task);
+        }
+    }
+}
+
+template <typename TBuild>
+void run(const std::string &name, TBuild &&build, int tasks, int width, int rounds, ThreadPoolDispatcher &dispatcher)
+{
+    TaskGraph graph;
+    build(graph, tasks, width);
+    executed.store(0);
+    auto start = Clock::now();
+    for (auto round = 0; round < rounds; ++round) {
+        graph.run(dispatcher);
+        graph.wait();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    auto expected = static_cast<std::int64_t>(graph.size()) * rounds;
+    std::cout << name << ',' << elapsed / expected;
+    if (executed.load() != expected) {
+        std::cout << ",ran " << executed.load() << " of " << expected;
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto tasks = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto width = argc > 2 ? std::atoi(argv[2]) : 64;
+    auto rounds = argc > 3 ? std::atoi(argv[3]) : 10;
+    auto workers = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    ThreadPoolDispatcher dispatcher(workers);
+    std::cout << "shape,ns_per_task" << std::endl;
+    run("chain", chain, tasks, width, rounds, dispatcher);
+    run("fan", fan, tasks, width, rounds, dispatcher);
+    run("layers", layers, tasks, width, rounds, dispatcher);
+    return 0;
+}
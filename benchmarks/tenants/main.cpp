@@ -0,0 +1,109 @@
+// CPU shares of tenant groups on one TenantDispatcher.
+//
+// Each group gets `actors` actors that keep themselves busy: every message
+// burns `work_us` of CPU and sends the next one to self. With all groups
+// saturated for `duration_ms`, prints each group's weight, messages
+// handled and share of handler time, which should follow the weights.
+//
+// usage: tenants [duration_ms] [actors] [work_us] [workers] [weight ...]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/tenant_dispatcher.hpp>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic_bool running{true};
+
+class Work : public Message
+{
+};
+
+class Busy : public IActor
+{
+public:
+    Busy(std::chrono::microseconds work, std::atomic<std::uint64_t> &handled)
+        : work_{work}
+        , handled_(handled)
+    {
+    }
+
+    virtual void receive(const IContext &context) override
+    {
+        if (!dynamic_cast<Work *>(context.message().get())) {
+            return;
+        }
+        auto until = Clock::now() + work_;
+        while (Clock::now() < until) {
+        }
+        handled_.fetch_add(1, std::memory_order_relaxed);
+        if (running.load(std::memory_order_relaxed)) {
+            const_cast<PID &>(context.self()).tell<Work>();
+        }
+    }
+
+private:
+    std::chrono::microseconds work_;
+    std::atomic<std::uint64_t> &handled_;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto duration = std::chrono::milliseconds(argc > 1 ? std::atoi(argv[1]) : 1000);
+    auto actors = argc > 2 ? std::atoi(argv[2]) : 8;
+    auto work = std::chrono::microseconds(argc > 3 ? std::atoi(argv[3]) : 20);
+    auto workers = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<double> weights;
+    for (auto i = 5; i < argc; ++i) {
+        weights.push_back(std::atof(argv[i]));
+    }
+    if (weights.empty()) {
+        weights = {1, 3};
+    }
+
+    TenantDispatcher dispatcher(workers);
+    std::vector<TenantDispatcher::Group *> groups;
+    std::vector<std::atomic<std::uint64_t>> handled(weights.size());
+    std::vector<std::unique_ptr<PID>> pids;
+    for (std::size_t g = 0; g < weights.size(); ++g) {
+        groups.push_back(&dispatcher.add_group(weights[g]));
+        auto counter = &handled[g];
+        auto props = Actor::from_producer([work, counter]() { return std::make_unique<Busy>(work, *counter); });
+        props->with_dispatcher(*groups.back());
+        for (auto i = 0; i < actors; ++i) {
+            pids.push_back(Actor::spawn(*props));
+        }
+    }
+    for (auto &pid : pids) {
+        pid->tell<Work>();
+    }
+    std::this_thread::sleep_for(duration);
+    running.store(false);
+
+    std::int64_t total = 0;
+    for (auto group : groups) {
+        total += group->consumed();
+    }
+    std::cout << "weight,handled,time_share" << std::endl;
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        std::cout << weights[g] << ',' << handled[g].load() << ',' << static_cast<double>(groups[g]->consumed()) / static_cast<double>(total) << std::endl;
+    }
+    for (auto &pid : pids) {
+        pid->stop();
+    }
+    return 0;
+}
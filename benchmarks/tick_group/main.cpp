@@ -0,0 +1,91 @@
+// Shared periodic ticks.
+//
+// Subscribes `actors` actors to one TickGroups group with a period of
+// `period_ms`, then counts the ticks delivered over `ticks` periods. Prints
+// the time taken to subscribe them all and how many ticks each actor got on
+// average, which falls short of `ticks` when a tick cannot reach every
+// subscriber within one period. Then stops every other actor and checks that
+// the rest keep ticking.
+//
+// usage: tick_group [actors] [period_ms] [ticks] [workers]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <protoactor/tick_group.hpp>
+#include <thread>
+#include <vector>
+
+using namespace protoactor;
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+std::atomic<std::int64_t> received{0};
+
+class Listener : public IActor
+{
+public:
+    virtual void receive(const IContext &context) override
+    {
+        if (dynamic_cast<TickMessage *>(context.message().get())) {
+            received.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto actors = argc > 1 ? std::atoi(argv[1]) : 10000;
+    auto period_ms = argc > 2 ? std::atoi(argv[2]) : 10;
+    auto ticks = argc > 3 ? std::atoi(argv[3]) : 100;
+    auto workers = argc > 4 ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+
+    ThreadPoolDispatcher dispatcher(workers);
+    auto props = Actor::from_producer([]() { return std::make_unique<Listener>(); });
+    props->with_dispatcher(dispatcher);
+    std::vector<std::unique_ptr<PID>> pids;
+    for (auto i = 0; i < actors; ++i) {
+        pids.push_back(Actor::spawn(*props));
+    }
+
+    auto period = std::chrono::milliseconds(period_ms);
+    auto start = Clock::now();
+    for (auto &pid : pids) {
+        TickGroups::instance().subscribe("bench", period, *pid);
+    }
+    auto subscribed = Clock::now();
+    std::this_thread::sleep_for(period / 2);
+    auto before = received.load();
+    std::this_thread::sleep_for(period * ticks);
+    auto delivered = static_cast<double>(received.load() - before) / actors;
+    std::cout << "actors,period_ms,subscribe_us,ticks,ticks_per_actor" << std::endl;
+    std::cout << actors << ',' << period_ms << ',' << std::chrono::duration_cast<std::chrono::microseconds>(subscribed - start).count()
+              << ',' << ticks << ',' << delivered << std::endl;
+
+    for (std::size_t i = 0; i < pids.size(); i += 2) {
+        pids[i]->stop();
+    }
+    std::this_thread::sleep_for(period * 2);
+    before = received.load();
+    std::this_thread::sleep_for(period * 10);
+    auto survivors = static_cast<std::int64_t>(pids.size() / 2);
+    std::cout << "after stopping half: " << (received.load() - before) / std::max(survivors, std::int64_t{1})
+              << " ticks per survivor in 10 periods" << std::endl;
+
+    for (std::size_t i = 1; i < pids.size(); i += 2) {
+        TickGroups::instance().unsubscribe("bench", *pids[i]);
+        pids[i]->stop();
+    }
+    return 0;
+}
@@ -0,0 +1,278 @@
+#ifndef PROTOACTOR_BALANCING_POOL_HPP
+#define PROTOACTOR_BALANCING_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <protoactor/protoactor.hpp>
+#include <utility>
+#include <vector>
+
+namespace protoactor
+{
+
+class BalancingMailbox;
+
+// The user messages of a BalancingPool, shared by all of its members.
+class BalancingQueue
+{
+public:
+    using Members = std::vector<std::weak_ptr<BalancingMailbox>>;
+
+    std::size_t depth() const
+    {
+        return queued_.load(std::memory_order_relaxed);
+    }
+
+    bool has_messages() const
+    {
+        return messages_.has_messages();
+    }
+
+    const Members &members() const
+    {
+        return members_;
+    }
+
+    // Members are only ever added before any message is posted.
+    void add_member(const std::shared_ptr<BalancingMailbox> &member)
+    {
+        members_.push_back(member);
+    }
+
+    std::size_t next_member()
+    {
+        return cursor_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    MessageEnvelope pop()
+    {
+        auto envelope = messages_.pop();
+        if (envelope) {
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return envelope;
+    }
+
+    void push(MessageEnvelope envelope)
+    {
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        messages_.push(std::move(envelope));
+    }
+
+private:
+    UnboundedMailboxQueue messages_;
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> cursor_{0};
+    Members members_;
+};
+
+// A member's view of its pool's BalancingQueue, drained by its mailbox as
+// its user messages. Counts what this member took, as those were never
+// posted to it.
+class BalancingMemberQueue : public IMailboxQueue
+{
+public:
+    explicit BalancingMemberQueue(std::shared_ptr<BalancingQueue> queue)
+        : queue_{std::move(queue)}
+    {
+    }
+
+    virtual bool has_messages() const override
+    {
+        return queue_->has_messages();
+    }
+
+    // Only ever called by the thread running the member.
+    virtual MessageEnvelope pop() override
+    {
+        auto envelope = queue_->pop();
+        if (envelope) {
+            taken_.store(taken_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        return envelope;
+    }
+
+    virtual bool push(MessageEnvelope envelope) override
+    {
+        queue_->push(std::move(envelope));
+        return true;
+    }
+
+    std::size_t taken() const
+    {
+        return taken_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<BalancingQueue> queue_;
+    std::atomic<std::size_t> taken_{0};
+};
+
+// A DefaultMailbox with system messages of its own and user messages taken
+// from a BalancingQueue. In addition, posting a user message wakes an idle
+// member of the pool, so that work goes to whichever member is free rather
+// than waiting behind a slow message.
+//
+// A suspended member takes no user messages and is not woken for them, nor
+// is one that has been sent StopMessage.
+class BalancingMailbox : public DefaultMailbox
+{
+public:
+    explicit BalancingMailbox(std::shared_ptr<BalancingQueue> queue)
+        : DefaultMailbox{std::make_unique<UnboundedMailboxQueue>(), std::make_unique<BalancingMemberQueue>(queue)}
+        , queue_{std::move(queue)}
+    {
+    }
+
+    // Wakes up to `count` idle members, starting from a different one on
+    // every call. Busy members look at the queue again before going idle,
+    // so a message posted while every member is busy is not left behind.
+    static void wake(BalancingQueue &queue, std::size_t count)
+    {
+        auto &members = queue.members();
+        auto size = members.size();
+        auto first = queue.next_member();
+        ScheduleBatch batch;
+        for (std::size_t i = 0; i < size && count > 0; ++i) {
+            auto member = members[(first + i) % size].lock();
+            if (member && member->try_schedule()) {
+                --count;
+            }
+        }
+    }
+
+    // Pending system messages and an even share of the pool's backlog.
+    virtual std::size_t depth() const override
+    {
+        auto system = DefaultMailbox::depth() + static_cast<const BalancingMemberQueue &>(user_messages()).taken();
+        return system + queue_->depth() / std::max<std::size_t>(queue_->members().size(), 1);
+    }
+
+    virtual void post_user_message(MessageEnvelope envelope) override
+    {
+        queue_->push(std::move(envelope));
+        wake(*queue_, 1);
+    }
+
+    virtual void post_user_messages(MessageEnvelope *envelopes, std::size_t count) override
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            queue_->push(std::move(envelopes[i]));
+        }
+        wake(*queue_, count);
+    }
+
+protected:
+    // A stopped member stays suspended, so that it leaves the pool's
+    // messages to the others.
+    virtual void system_message_received(const Message &message) override
+    {
+        if (dynamic_cast<const StopMessage *>(&message)) {
+            retired_ = true;
+        }
+        if (retired_) {
+            suspend();
+        }
+    }
+
+private:
+    bool try_schedule()
+    {
+        return !suspended() && schedule();
+    }
+
+    std::shared_ptr<BalancingQueue> queue_;
+    bool retired_{false};
+};
+
+// `instances` actors spawned from the same props, pulling from one shared
+// queue: a message goes to whichever member is free, so one slow message
+// delays only the member handling it. Members should be stateless, as any
+// of them may get any message, and messages are not kept in order across
+// members. The props' mailbox producer is replaced.
+//
+// Messages still queued when the members stop, and any told to the pool
+// after stop(), stay in its queue unprocessed until the pool and its
+// members' mailboxes are gone.
+//
+// With PROTOACTOR_NO_EXCEPTIONS, a member that fails to spawn is left out
+// of members().
+class BalancingPool
+{
+public:
+    BalancingPool(const Props &props, std::size_t instances)
+        : queue_{std::make_shared<BalancingQueue>()}
+    {
+        std::vector<std::shared_ptr<BalancingMailbox>> mailboxes;
+        mailboxes.reserve(instances);
+        for (std::size_t i = 0; i < instances; ++i) {
+            mailboxes.push_back(std::make_shared<BalancingMailbox>(queue_));
+            queue_->add_member(mailboxes.back());
+        }
+        Props member_props{props};
+        std::size_t next = 0;
+        member_props.with_mailbox([&mailboxes, &next]() -> std::shared_ptr<IMailbox> {
+            return mailboxes[next++];
+        });
+        members_.reserve(instances);
+        for (std::size_t i = 0; i < instances; ++i) {
+            if (auto member = Actor::spawn(member_props)) {
+                members_.push_back(*member);
+            }
+        }
+    }
+
+    std::size_t depth() const
+    {
+        return queue_->depth();
+    }
+
+    const std::vector<PID> &members() const
+    {
+        return members_;
+    }
+
+    void stop()
+    {
+        for (auto &member : members_) {
+            member.stop();
+        }
+    }
+
+    template <typename TMessage, typename... TArgs>
+    void tell(TArgs &&...args)
+    {
+        tell(Message::UPtr{new TMessage(std::forward<TArgs>(args)...)});
+    }
+
+    void tell(Message::UPtr message)
+    {
+        tell(MessageEnvelope{std::move(message)});
+    }
+
+    void tell(MessageEnvelope envelope)
+    {
+        queue_->push(std::move(envelope));
+        BalancingMailbox::wake(*queue_, 1);
+    }
+
+    // Moves `count` messages out of `envelopes`, waking as many members.
+    void tell(MessageEnvelope *envelopes, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            queue_->push(std::move(envelopes[i]));
+        }
+        BalancingMailbox::wake(*queue_, count);
+    }
+
+private:
+    std::shared_ptr<BalancingQueue> queue_;
+    std::vector<PID> members_;
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_BALANCING_POOL_HPP
@@ -0,0 +1,164 @@
+#ifndef PROTOACTOR_CLOCK_HPP
+#define PROTOACTOR_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define PROTOACTOR_HAS_TSC 1
+#endif
+
+namespace protoactor
+{
+
+// Cheap timestamps for hot-path instrumentation, in steady_clock nanoseconds.
+//
+// coarse_now() is a single relaxed load of a value that the bundled
+// dispatchers refresh after every run and, optionally, a ticker thread
+// refreshes periodically. A refresh only writes when the time has moved by
+// at least `granularity`, so that the line every worker reads is not
+// invalidated after every run. Actors on other IDispatcher implementations
+// see the time advance only while start_ticker() runs. precise_now()
+// reads the TSC once enable_tsc() has calibrated it against steady_clock,
+// and falls back to steady_clock otherwise.
+class RuntimeClock
+{
+public:
+    static RuntimeClock &instance()
+    {
+        static RuntimeClock _instance;
+        return _instance;
+    }
+
+    ~RuntimeClock()
+    {
+        stop_ticker();
+    }
+
+    // In nanoseconds.
+    static const std::int64_t granularity = 100 * 1000;
+
+    std::int64_t coarse_now() const
+    {
+        return coarse_.value.load(std::memory_order_relaxed);
+    }
+
+    void update()
+    {
+        update(steady_now());
+    }
+
+    // For callers that have just read the time anyway.
+    void update(std::int64_t now)
+    {
+        auto coarse = coarse_.value.load(std::memory_order_relaxed);
+        if (now - coarse >= granularity) {
+            coarse_.value.compare_exchange_strong(coarse, now, std::memory_order_relaxed);
+        }
+    }
+
+    void start_ticker(std::chrono::microseconds period)
+    {
+        stop_ticker();
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = false;
+        ticker_ = std::thread([this, period]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_requested_.wait_for(lock, period, [this]() { return stopping_; })) {
+                update();
+            }
+        });
+    }
+
+    void stop_ticker()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        stop_requested_.notify_all();
+        if (ticker_.joinable()) {
+            ticker_.join();
+        }
+    }
+
+    // Calibrates the TSC over `calibration` and switches precise_now() to it.
+    // Returns false, leaving steady_clock in use, when the CPU has no
+    // invariant TSC. Meant to be called once, at startup.
+    bool enable_tsc(std::chrono::milliseconds calibration = std::chrono::milliseconds(10))
+    {
+#ifdef PROTOACTOR_HAS_TSC
+        if (tsc_enabled()) {
+            return true;
+        }
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+            return false;
+        }
+        auto steady_start = steady_now();
+        auto tsc_start = __rdtsc();
+        std::this_thread::sleep_for(calibration);
+        auto steady_end = steady_now();
+        auto tsc_end = __rdtsc();
+        ns_per_tick_ = static_cast<double>(steady_end - steady_start) / static_cast<double>(tsc_end - tsc_start);
+        tsc_base_ = tsc_end;
+        steady_base_ = steady_end;
+        tsc_enabled_.store(true, std::memory_order_release);
+        return true;
+#else
+        (void)calibration;
+        return false;
+#endif
+    }
+
+    bool tsc_enabled() const
+    {
+        return tsc_enabled_.load(std::memory_order_acquire);
+    }
+
+    std::int64_t precise_now() const
+    {
+#ifdef PROTOACTOR_HAS_TSC
+        if (tsc_enabled()) {
+            auto ticks = static_cast<std::int64_t>(__rdtsc() - tsc_base_);
+            return steady_base_ + static_cast<std::int64_t>(static_cast<double>(ticks) * ns_per_tick_);
+        }
+#endif
+        return steady_now();
+    }
+
+    static std::int64_t steady_now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    // Kept on a cache line of its own: it is read from every worker.
+    class alignas(64) CoarseTime
+    {
+    public:
+        std::atomic<std::int64_t> value{steady_now()};
+    };
+
+    RuntimeClock() = default;
+
+    CoarseTime coarse_;
+    std::atomic_bool tsc_enabled_{false};
+    double ns_per_tick_{0};
+    std::uint64_t tsc_base_{0};
+    std::int64_t steady_base_{0};
+    std::mutex mutex_;
+    std::condition_variable stop_requested_;
+    bool stopping_{false};
+    std::thread ticker_;
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_CLOCK_HPP
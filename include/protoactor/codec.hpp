@@ -0,0 +1,491 @@
+#ifndef PROTOACTOR_CODEC_HPP
+#define PROTOACTOR_CODEC_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOACTOR_HAS_SSE_TARGET 1
+#endif
+
+namespace protoactor
+{
+namespace codec
+{
+
+// Integer codecs for wire and persistence formats. Encoders write to a buffer
+// that the caller sizes with max_size() and return the end of what they
+// wrote; decoders return the end of what they read, or nullptr when the
+// input is truncated or malformed. Bulk decoders use SSE4.1/SSSE3 when the
+// CPU has them, with scalar fallbacks that give the same results.
+
+inline std::uint32_t zigzag_encode(std::int32_t value)
+{
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+inline std::int32_t zigzag_decode(std::uint32_t value)
+{
+    return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1);
+}
+
+inline std::uint64_t zigzag_encode(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t zigzag_decode(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+// LEB128, as used by Protobuf: seven bits per byte, low bits first.
+class Varint
+{
+public:
+    static std::size_t max_size(std::size_t count)
+    {
+        return count * 10;
+    }
+
+    static std::size_t size(std::uint64_t value)
+    {
+        std::size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            ++size;
+        }
+        return size;
+    }
+
+    static std::uint8_t *encode(std::uint64_t value, std::uint8_t *out)
+    {
+        while (value >= 0x80) {
+            *out++ = static_cast<std::uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<std::uint8_t>(value);
+        return out;
+    }
+
+    // Values that do not fit in 64 bits, i.e. a tenth byte above 1, are
+    // malformed.
+    static const std::uint8_t *decode(const std::uint8_t *in, const std::uint8_t *end, std::uint64_t &value)
+    {
+        std::uint64_t result = 0;
+        for (unsigned shift = 0; shift < 64 && in < end; shift += 7) {
+            auto byte = *in++;
+            if (shift == 63 && byte > 1) {
+                return nullptr;
+            }
+            result |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                value = result;
+                return in;
+            }
+        }
+        return nullptr;
+    }
+
+    // Scalar only: with mixed lengths a SIMD encoder loses to the
+    // predictable byte loop.
+    static std::uint8_t *encode(const std::uint32_t *values, std::size_t count, std::uint8_t *out)
+    {
+        return encode_scalar(values, count, out);
+    }
+
+    // Values that do not fit in 32 bits are malformed, and so are encodings
+    // longer than five bytes, even of values that would.
+    static const std::uint8_t *decode(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count)
+    {
+#ifdef PROTOACTOR_HAS_SSE_TARGET
+        if (has_sse41()) {
+            return decode_sse41(in, end, values, count);
+        }
+#endif
+        return decode_scalar(in, end, values, count);
+    }
+
+    static std::uint8_t *encode_scalar(const std::uint32_t *values, std::size_t count, std::uint8_t *out)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            out = encode(values[i], out);
+        }
+        return out;
+    }
+
+    static const std::uint8_t *decode_scalar(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count && in; ++i) {
+            in = decode_one(in, end, values[i]);
+        }
+        return in;
+    }
+
+private:
+    // At most five bytes, like decode_sse41().
+    static const std::uint8_t *decode_one(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t &value)
+    {
+        std::uint64_t result = 0;
+        for (unsigned shift = 0; shift < 35 && in < end; shift += 7) {
+            auto byte = *in++;
+            result |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                if (result > std::numeric_limits<std::uint32_t>::max()) {
+                    return nullptr;
+                }
+                value = static_cast<std::uint32_t>(result);
+                return in;
+            }
+        }
+        return nullptr;
+    }
+
+#ifdef PROTOACTOR_HAS_SSE_TARGET
+    // Indexed by the continuation bits of twelve bytes. Six varints of one or
+    // two bytes use one of the first 64 shuffles, into 16-bit lanes; four of
+    // one to three bytes one of the next 81, into 32-bit lanes.
+    class Table
+    {
+    public:
+        static const std::uint8_t two_byte_shuffles = 64;
+        static const std::uint8_t none = 0xff;
+
+        Table()
+        {
+            std::memset(shuffle, 0x80, sizeof(shuffle));
+            for (unsigned window = 0; window < 4096; ++window) {
+                unsigned lengths[12];
+                unsigned found = 0;
+                unsigned start = 0;
+                for (unsigned byte = 0; byte < 12; ++byte) {
+                    if (!(window & (1u << byte))) {
+                        lengths[found++] = byte + 1 - start;
+                        start = byte + 1;
+                    }
+                }
+                index[window] = none;
+                length[window] = 0;
+                if (found >= 6 && std::all_of(lengths, lengths + 6, [](unsigned n) { return n <= 2; })) {
+                    add(window, lengths, 6, 2);
+                } else if (found >= 4 && std::all_of(lengths, lengths + 4, [](unsigned n) { return n <= 3; })) {
+                    add(window, lengths, 4, 3);
+                }
+            }
+        }
+
+        alignas(16) std::uint8_t shuffle[64 + 81][16];
+        std::uint8_t index[4096];
+        std::uint8_t length[4096];
+
+    private:
+        // Numbers the shuffle by the lengths read as digits of base
+        // `max_length`, and fills it in.
+        void add(unsigned window, const unsigned *lengths, unsigned count, unsigned max_length)
+        {
+            unsigned number = 0;
+            unsigned offset = 0;
+            for (unsigned j = count; j-- > 0;) {
+                number = number * max_length + lengths[j] - 1;
+            }
+            if (max_length == 3) {
+                number += two_byte_shuffles;
+            }
+            auto lane = count == 6 ? 2u : 4u;
+            for (unsigned j = 0; j < count; ++j) {
+                for (unsigned k = 0; k < lengths[j]; ++k) {
+                    shuffle[number][lane * j + k] = static_cast<std::uint8_t>(offset + k);
+                }
+                offset += lengths[j];
+            }
+            index[window] = static_cast<std::uint8_t>(number);
+            length[window] = static_cast<std::uint8_t>(offset);
+        }
+    };
+
+    static bool has_sse41()
+    {
+        static const bool _has = __builtin_cpu_supports("sse4.1");
+        return _has;
+    }
+
+    static const Table &table()
+    {
+        static const Table _table;
+        return _table;
+    }
+
+    // Masked VByte: the continuation bits of the next twelve bytes index a
+    // table that says whether the first six varints there have at most two
+    // bytes, or the first four at most three, and how to shuffle them into
+    // 16- or 32-bit lanes, where masks and shifts drop the continuation bits.
+    // Sixteen single-byte values are widened in registers. Other windows are
+    // decoded one varint at a time from where one movemask says they end,
+    // each from a single unaligned read.
+    __attribute__((target("sse4.1")))
+    static const std::uint8_t *decode_sse41(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count)
+    {
+        auto &shuffles = table();
+        const auto short_low_7 = _mm_set1_epi16(0x7f);
+        const auto short_high_7 = _mm_set1_epi16(0x7f00);
+        const auto low_7 = _mm_set1_epi32(0x7f);
+        const auto middle_7 = _mm_set1_epi32(0x7f00);
+        const auto high_7 = _mm_set1_epi32(0x7f0000);
+        std::size_t i = 0;
+        while (i < count) {
+            // The window plus slack for the eight-byte reads.
+            if (end - in < 24) {
+                return decode_scalar(in, end, values + i, count - i);
+            }
+            auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+            auto continued = static_cast<unsigned>(_mm_movemask_epi8(bytes));
+            if (!continued && count - i >= 16) {
+                auto out = reinterpret_cast<__m128i *>(values + i);
+                _mm_storeu_si128(out, _mm_cvtepu8_epi32(bytes));
+                _mm_storeu_si128(out + 1, _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)));
+                _mm_storeu_si128(out + 2, _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+                _mm_storeu_si128(out + 3, _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12)));
+                in += 16;
+                i += 16;
+                continue;
+            }
+            auto window = continued & 0xfff;
+            auto index = shuffles.index[window];
+            if (index < Table::two_byte_shuffles && count - i >= 8) {
+                auto mask = _mm_load_si128(reinterpret_cast<const __m128i *>(shuffles.shuffle[index]));
+                auto lanes = _mm_shuffle_epi8(bytes, mask);
+                auto shorts = _mm_or_si128(_mm_and_si128(lanes, short_low_7), _mm_srli_epi16(_mm_and_si128(lanes, short_high_7), 1));
+                auto out = reinterpret_cast<__m128i *>(values + i);
+                _mm_storeu_si128(out, _mm_cvtepu16_epi32(shorts));
+                _mm_storeu_si128(out + 1, _mm_cvtepu16_epi32(_mm_srli_si128(shorts, 8)));
+                in += shuffles.length[window];
+                i += 6;
+                continue;
+            }
+            if (index >= Table::two_byte_shuffles && index != Table::none && count - i >= 4) {
+                auto mask = _mm_load_si128(reinterpret_cast<const __m128i *>(shuffles.shuffle[index]));
+                auto lanes = _mm_shuffle_epi8(bytes, mask);
+                auto value = _mm_or_si128(_mm_and_si128(lanes, low_7), _mm_srli_epi32(_mm_and_si128(lanes, middle_7), 1));
+                value = _mm_or_si128(value, _mm_srli_epi32(_mm_and_si128(lanes, high_7), 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(values + i), value);
+                in += shuffles.length[window];
+                i += 4;
+                continue;
+            }
+            auto ends = ~continued & 0xffff;
+            if (!ends) {
+                return nullptr;
+            }
+            unsigned position = 0;
+            while (ends && i < count) {
+                auto last = static_cast<unsigned>(__builtin_ctz(ends));
+                auto length = last + 1 - position;
+                if (length > 5) {
+                    return nullptr;
+                }
+                std::uint64_t word;
+                std::memcpy(&word, in + position, sizeof(word));
+                word &= ~std::uint64_t{0} >> (64 - 8 * length);
+                auto value = (word & 0x7f) | ((word >> 1) & 0x3f80) | ((word >> 2) & 0x1fc000) | ((word >> 3) & 0xfe00000) | ((word >> 4) & 0x7f0000000ull);
+                if (value > std::numeric_limits<std::uint32_t>::max()) {
+                    return nullptr;
+                }
+                values[i++] = static_cast<std::uint32_t>(value);
+                position = last + 1;
+                ends &= ends - 1;
+            }
+            in += position;
+        }
+        return in;
+    }
+#endif
+};
+
+// Group varint: four 32-bit values behind one tag byte holding their byte
+// lengths (1-4), two bits each. Decoding a group is one table lookup and
+// one SSSE3 shuffle. A partial last group is padded with zeros.
+class GroupVarint
+{
+public:
+    static std::size_t max_size(std::size_t count)
+    {
+        return (count + 3) / 4 * 17;
+    }
+
+    static std::uint8_t *encode(const std::uint32_t *values, std::size_t count, std::uint8_t *out)
+    {
+        for (std::size_t i = 0; i < count; i += 4) {
+            auto tag = out++;
+            *tag = 0;
+            for (std::size_t j = 0; j < 4; ++j) {
+                auto value = i + j < count ? values[i + j] : 0;
+                auto length = byte_length(value);
+                *tag |= static_cast<std::uint8_t>((length - 1) << (2 * j));
+                for (std::size_t k = 0; k < length; ++k) {
+                    *out++ = static_cast<std::uint8_t>(value >> (8 * k));
+                }
+            }
+        }
+        return out;
+    }
+
+    static const std::uint8_t *decode(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count)
+    {
+#ifdef PROTOACTOR_HAS_SSE_TARGET
+        if (has_ssse3()) {
+            return decode_ssse3(in, end, values, count);
+        }
+#endif
+        return decode_scalar(in, end, values, count);
+    }
+
+    static const std::uint8_t *decode_scalar(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i += 4) {
+            if (in >= end) {
+                return nullptr;
+            }
+            auto tag = *in++;
+            for (std::size_t j = 0; j < 4; ++j) {
+                auto length = static_cast<std::size_t>((tag >> (2 * j)) & 3) + 1;
+                if (static_cast<std::size_t>(end - in) < length) {
+                    return nullptr;
+                }
+                std::uint32_t value = 0;
+                for (std::size_t k = 0; k < length; ++k) {
+                    value |= static_cast<std::uint32_t>(in[k]) << (8 * k);
+                }
+                in += length;
+                if (i + j < count) {
+                    values[i + j] = value;
+                }
+            }
+        }
+        return in;
+    }
+
+private:
+    class Table
+    {
+    public:
+        Table()
+        {
+            for (unsigned tag = 0; tag < 256; ++tag) {
+                std::uint8_t offset = 0;
+                for (unsigned j = 0; j < 4; ++j) {
+                    auto length = ((tag >> (2 * j)) & 3) + 1;
+                    for (unsigned k = 0; k < 4; ++k) {
+                        shuffle[tag][4 * j + k] = k < length ? static_cast<std::uint8_t>(offset + k) : 0x80;
+                    }
+                    offset = static_cast<std::uint8_t>(offset + length);
+                }
+                length[tag] = offset;
+            }
+        }
+
+        alignas(16) std::uint8_t shuffle[256][16];
+        std::uint8_t length[256];
+    };
+
+    static std::size_t byte_length(std::uint32_t value)
+    {
+        return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+    }
+
+#ifdef PROTOACTOR_HAS_SSE_TARGET
+    static bool has_ssse3()
+    {
+        static const bool _has = __builtin_cpu_supports("ssse3");
+        return _has;
+    }
+
+    static const Table &table()
+    {
+        static const Table _table;
+        return _table;
+    }
+
+    // Full groups with sixteen readable bytes after the tag go through the
+    // shuffle; the rest, at the end of the input, through the scalar path.
+    __attribute__((target("ssse3")))
+    static const std::uint8_t *decode_ssse3(const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *values, std::size_t count)
+    {
+        auto &shuffles = table();
+        std::size_t i = 0;
+        for (; i + 4 <= count && end - in >= 17; i += 4) {
+            auto tag = *in;
+            auto data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 1));
+            auto mask = _mm_load_si128(reinterpret_cast<const __m128i *>(shuffles.shuffle[tag]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(values + i), _mm_shuffle_epi8(data, mask));
+            in += 1 + shuffles.length[tag];
+        }
+        return decode_scalar(in, end, values + i, count - i);
+    }
+#endif
+};
+
+// Little-endian fixed-width integers; a plain copy on little-endian hosts.
+class FixedWidth
+{
+public:
+    template <typename T>
+    static std::size_t max_size(std::size_t count)
+    {
+        return count * sizeof(T);
+    }
+
+    template <typename T>
+    static std::uint8_t *encode(const T *values, std::size_t count, std::uint8_t *out)
+    {
+        static_assert(std::is_integral<T>::value, "FixedWidth encodes integers");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (count) {
+            std::memcpy(out, values, count * sizeof(T));
+        }
+        return out + count * sizeof(T);
+#else
+        for (std::size_t i = 0; i < count; ++i) {
+            auto value = static_cast<typename std::make_unsigned<T>::type>(values[i]);
+            for (std::size_t k = 0; k < sizeof(T); ++k) {
+                *out++ = static_cast<std::uint8_t>(value >> (8 * k));
+            }
+        }
+        return out;
+#endif
+    }
+
+    template <typename T>
+    static const std::uint8_t *decode(const std::uint8_t *in, const std::uint8_t *end, T *values, std::size_t count)
+    {
+        static_assert(std::is_integral<T>::value, "FixedWidth decodes integers");
+        if (static_cast<std::size_t>(end - in) < count * sizeof(T)) {
+            return nullptr;
+        }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (count) {
+            std::memcpy(values, in, count * sizeof(T));
+        }
+        return in + count * sizeof(T);
+#else
+        using Unsigned = typename std::make_unsigned<T>::type;
+        for (std::size_t i = 0; i < count; ++i) {
+            Unsigned value = 0;
+            for (std::size_t k = 0; k < sizeof(T); ++k) {
+                value |= static_cast<Unsigned>(*in++) << (8 * k);
+            }
+            values[i] = static_cast<T>(value);
+        }
+        return in;
+#endif
+    }
+};
+
+} // namespace codec
+} // namespace protoactor
+
+#endif // PROTOACTOR_CODEC_HPP
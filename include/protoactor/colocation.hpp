@@ -0,0 +1,157 @@
+#ifndef PROTOACTOR_COLOCATION_HPP
+#define PROTOACTOR_COLOCATION_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <protoactor/communication_graph.hpp>
+#include <protoactor/protoactor.hpp>
+#include <protoactor/thread_pool_dispatcher.hpp>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace protoactor
+{
+
+// Periodically pins the heaviest communicating pairs of the communication
+// graph onto the same worker of a ThreadPoolDispatcher. Only actors whose
+// mailboxes run on that dispatcher are pinned, and an actor that drops out
+// of the heaviest edges is unpinned again.
+class ColocationPlacement
+{
+public:
+    ColocationPlacement(ThreadPoolDispatcher &dispatcher, CommunicationGraph &graph = CommunicationGraph::instance())
+        : dispatcher_(dispatcher)
+        , graph_(graph)
+    {
+    }
+
+    ~ColocationPlacement()
+    {
+        stop();
+    }
+
+    ColocationPlacement &with_max_edges(std::size_t max_edges)
+    {
+        max_edges_ = max_edges;
+        return *this;
+    }
+
+    void start(std::chrono::milliseconds period)
+    {
+        stop();
+        stopping_ = false;
+        thread_ = std::thread([this, period]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_requested_.wait_for(lock, period, [this]() { return stopping_; })) {
+                lock.unlock();
+                rebalance();
+                lock.lock();
+            }
+        });
+    }
+
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        stop_requested_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // Assigns a worker to both endpoints of each of the heaviest edges
+    // between actors on this dispatcher: an edge follows whichever endpoint
+    // was already placed in this round, otherwise it goes to the least loaded
+    // worker. Actors pinned in the previous round but not in this one are
+    // unpinned. Decays the graph afterwards.
+    void rebalance()
+    {
+        std::unique_lock<std::mutex> lock(rebalance_mutex_);
+        auto edges = graph_.edges();
+        if (edges.size() > max_edges_) {
+            edges.resize(max_edges_);
+        }
+        // Held, as the actors may be stopped and removed meanwhile.
+        std::unordered_map<std::string, std::shared_ptr<IMailbox>> mailboxes;
+        std::unordered_map<std::string, int> assignment;
+        std::vector<std::uint64_t> load(static_cast<std::size_t>(dispatcher_.worker_count()), 0);
+        for (auto &edge : edges) {
+            if (!mailbox(mailboxes, edge.sender) || !mailbox(mailboxes, edge.receiver)) {
+                continue;
+            }
+            auto sender = assignment.find(edge.sender);
+            auto receiver = assignment.find(edge.receiver);
+            if (sender != assignment.end() && receiver != assignment.end()) {
+                continue;
+            }
+            int worker;
+            if (sender != assignment.end()) {
+                worker = sender->second;
+            } else if (receiver != assignment.end()) {
+                worker = receiver->second;
+            } else {
+                worker = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+            }
+            assignment.emplace(edge.sender, worker);
+            assignment.emplace(edge.receiver, worker);
+            load[static_cast<std::size_t>(worker)] += edge.weight;
+        }
+        for (auto &id : pinned_) {
+            if (!assignment.count(id)) {
+                if (auto &unpinned = mailbox(mailboxes, id)) {
+                    unpinned->set_affinity(-1);
+                }
+            }
+        }
+        pinned_.clear();
+        for (auto &placed : assignment) {
+            mailboxes[placed.first]->set_affinity(placed.second);
+            pinned_.insert(placed.first);
+        }
+        graph_.decay();
+    }
+
+private:
+    // The mailbox of the actor `id` if it is local and runs on this
+    // dispatcher, otherwise nullptr; looked up once per round.
+    const std::shared_ptr<IMailbox> &mailbox(std::unordered_map<std::string, std::shared_ptr<IMailbox>> &mailboxes, const std::string &id) const
+    {
+        auto found = mailboxes.find(id);
+        if (found != mailboxes.end()) {
+            return found->second;
+        }
+        auto &result = mailboxes[id];
+        auto process = ProcessRegistry::instance().find(id);
+        if (auto local = dynamic_cast<LocalProcess *>(process.get())) {
+            if (local->mailbox()->dispatcher() == &dispatcher_) {
+                result = local->mailbox();
+            }
+        }
+        return result;
+    }
+
+    ThreadPoolDispatcher &dispatcher_;
+    CommunicationGraph &graph_;
+    std::size_t max_edges_{1024};
+    std::mutex rebalance_mutex_;
+    std::unordered_set<std::string> pinned_;
+    std::mutex mutex_;
+    std::condition_variable stop_requested_;
+    bool stopping_{false};
+    std::thread thread_;
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_COLOCATION_HPP
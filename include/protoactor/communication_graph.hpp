@@ -0,0 +1,135 @@
+#ifndef PROTOACTOR_COMMUNICATION_GRAPH_HPP
+#define PROTOACTOR_COMMUNICATION_GRAPH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace protoactor
+{
+
+class CommunicationEdge
+{
+public:
+    std::string sender;
+    std::string receiver;
+    std::uint64_t weight;
+};
+
+// Weighted sender -> receiver graph built from sampled PID::tell calls.
+// Sampling is off until set_sample_interval() is given a non-zero interval.
+class CommunicationGraph
+{
+public:
+    static CommunicationGraph &instance()
+    {
+        static CommunicationGraph _instance;
+        return _instance;
+    }
+
+    // Record one in every `interval` tells; 0 disables sampling.
+    void set_sample_interval(unsigned interval)
+    {
+        sample_interval_.store(interval, std::memory_order_relaxed);
+    }
+
+    unsigned sample_interval() const
+    {
+        return sample_interval_.load(std::memory_order_relaxed);
+    }
+
+    bool should_sample() const
+    {
+        auto interval = sample_interval();
+        if (interval == 0) {
+            return false;
+        }
+        static thread_local unsigned _countdown{0};
+        if (_countdown == 0) {
+            _countdown = interval;
+        }
+        return --_countdown == 0;
+    }
+
+    void record(const std::string &sender, const std::string &receiver, std::uint64_t weight = 1)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        edges_[Key{sender, receiver}] += weight;
+    }
+
+    // Edges sorted by descending weight.
+    std::vector<CommunicationEdge> edges() const
+    {
+        std::vector<CommunicationEdge> result;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            result.reserve(edges_.size());
+            for (auto &edge : edges_) {
+                result.push_back(CommunicationEdge{edge.first.first, edge.first.second, edge.second});
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const CommunicationEdge &a, const CommunicationEdge &b) {
+            return a.weight > b.weight;
+        });
+        return result;
+    }
+
+    // Halve every weight and drop edges that reach zero, so that old traffic
+    // fades out of the graph.
+    void decay()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto iter = edges_.begin(); iter != edges_.end();) {
+            iter->second /= 2;
+            if (iter->second == 0) {
+                iter = edges_.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    void clear()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        edges_.clear();
+    }
+
+    // Writes the graph in Graphviz DOT format.
+    void dump(std::ostream &out) const
+    {
+        out << "digraph communication {\n";
+        for (auto &edge : edges()) {
+            out << "    \"" << edge.sender << "\" -> \"" << edge.receiver << "\" [weight=" << edge.weight << "];\n";
+        }
+        out << "}\n";
+    }
+
+private:
+    using Key = std::pair<std::string, std::string>;
+
+    class KeyHash
+    {
+    public:
+        std::size_t operator()(const Key &key) const
+        {
+            std::hash<std::string> hash;
+            return hash(key.first) * 31 + hash(key.second);
+        }
+    };
+
+    std::unordered_map<Key, std::uint64_t, KeyHash> edges_;
+    mutable std::mutex mutex_;
+    std::atomic_uint sample_interval_{0};
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_COMMUNICATION_GRAPH_HPP
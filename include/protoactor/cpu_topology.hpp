@@ -0,0 +1,199 @@
+#ifndef PROTOACTOR_CPU_TOPOLOGY_HPP
+#define PROTOACTOR_CPU_TOPOLOGY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace protoactor
+{
+namespace mailbox
+{
+
+// Which CPUs share a core, a last-level cache and a socket, as read from
+// /sys/devices/system/cpu on Linux. Only the CPUs the process may run on are
+// listed. Elsewhere, or when /sys cannot be read, CPUs are numbered 0 to
+// hardware_concurrency() - 1 and each looks like a core of its own sharing
+// one cache with all the others.
+class CpuTopology
+{
+public:
+    // How far apart two CPUs are, nearest first.
+    enum class Distance
+    {
+        // SMT siblings of one core, or the same CPU.
+        Core,
+        // Different cores behind one last-level cache.
+        Cache,
+        // One socket, different last-level caches.
+        Socket,
+        Remote
+    };
+
+    static const std::size_t distance_count = 4;
+
+    class Cpu
+    {
+    public:
+        int id;
+        // Lowest CPU id of the core, cache and socket the CPU belongs to.
+        int core;
+        int cache;
+        int socket;
+    };
+
+    static const CpuTopology &instance()
+    {
+        static CpuTopology _instance;
+        return _instance;
+    }
+
+    explicit CpuTopology(const std::string &root = "/sys/devices/system/cpu")
+    {
+        std::vector<int> ids;
+        read_list(root + "/online", ids);
+#ifdef __linux__
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            ids.erase(std::remove_if(ids.begin(), ids.end(), [&allowed](int id) {
+                return id >= CPU_SETSIZE || !CPU_ISSET(id, &allowed);
+            }), ids.end());
+        }
+#endif
+        for (auto id : ids) {
+            auto cpu = root + "/cpu" + std::to_string(id);
+            cpus_.push_back(Cpu{id, lowest(cpu + "/topology/thread_siblings_list", id), last_level_cache(cpu), 0});
+            read_int(cpu + "/topology/physical_package_id", cpus_.back().socket);
+        }
+        if (cpus_.empty()) {
+            auto count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+            for (auto id = 0; id < count; ++id) {
+                cpus_.push_back(Cpu{id, id, 0, 0});
+            }
+        }
+        std::sort(cpus_.begin(), cpus_.end(), [](const Cpu &a, const Cpu &b) {
+            return std::tie(a.socket, a.cache, a.core, a.id) < std::tie(b.socket, b.cache, b.core, b.id);
+        });
+    }
+
+    // Ordered so that neighbours share as much as possible: the siblings of
+    // a core are next to each other, then the cores behind a cache, and so on.
+    const std::vector<Cpu> &cpus() const
+    {
+        return cpus_;
+    }
+
+    static Distance distance(const Cpu &a, const Cpu &b)
+    {
+        if (a.socket != b.socket) {
+            return Distance::Remote;
+        }
+        if (a.cache != b.cache) {
+            return Distance::Socket;
+        }
+        return a.core == b.core ? Distance::Core : Distance::Cache;
+    }
+
+    // Restricts the calling thread to `cpu`; false where that is not
+    // supported or not allowed.
+    static bool pin_current_thread(int cpu)
+    {
+#ifdef __linux__
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+private:
+    static bool read_int(const std::string &path, int &value)
+    {
+        std::ifstream file(path);
+        return static_cast<bool>(file >> value);
+    }
+
+    // Lists like "0-3,8,10-11".
+    static bool read_list(const std::string &path, std::vector<int> &ids)
+    {
+        std::ifstream file(path);
+        std::string list;
+        if (!std::getline(file, list)) {
+            return false;
+        }
+        auto position = list.c_str();
+        while (*position) {
+            char *end;
+            auto first = static_cast<int>(std::strtol(position, &end, 10));
+            auto last = first;
+            if (end == position) {
+                return false;
+            }
+            if (*end == '-') {
+                position = end + 1;
+                last = static_cast<int>(std::strtol(position, &end, 10));
+                if (end == position) {
+                    return false;
+                }
+            }
+            for (auto id = first; id <= last; ++id) {
+                ids.push_back(id);
+            }
+            position = *end == ',' ? end + 1 : end;
+            if (position == end && *end) {
+                return false;
+            }
+        }
+        return !ids.empty();
+    }
+
+    static int lowest(const std::string &path, int fallback)
+    {
+        std::vector<int> ids;
+        return read_list(path, ids) ? *std::min_element(ids.begin(), ids.end()) : fallback;
+    }
+
+    // The data or unified cache of the highest level, named by its lowest
+    // CPU; 0 when there is none.
+    static int last_level_cache(const std::string &cpu)
+    {
+        auto cache = 0;
+        auto highest = 0;
+        for (auto index = 0;; ++index) {
+            auto path = cpu + "/cache/index" + std::to_string(index);
+            int level;
+            if (!read_int(path + "/level", level)) {
+                return cache;
+            }
+            std::ifstream file(path + "/type");
+            std::string type;
+            file >> type;
+            if (type != "Instruction" && level > highest) {
+                highest = level;
+                cache = lowest(path + "/shared_cpu_list", 0);
+            }
+        }
+    }
+
+    std::vector<Cpu> cpus_;
+};
+
+} // namespace mailbox
+} // namespace protoactor
+
+#endif // PROTOACTOR_CPU_TOPOLOGY_HPP
@@ -0,0 +1,321 @@
+#ifndef PROTOACTOR_FAIR_MAILBOX_HPP
+#define PROTOACTOR_FAIR_MAILBOX_HPP
+
+#include <atomic>
+#include <boost/lockfree/queue.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <protoactor/mailbox.hpp>
+#include <protoactor/protoactor.hpp>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace protoactor
+{
+namespace mailbox
+{
+
+// Keeps a sub-queue per sender and drains them by deficit round robin, so
+// that one chatty sender cannot hold up everybody else's messages.
+//
+// Senders are told apart by Sender::id(), taken from the header or, for a
+// plain tell from inside an actor, from the sending actor; or by whatever key
+// the classifier returns, e.g. to group senders into classes. Messages told
+// from outside any actor share a sub-queue. Lookup is an open-addressed table
+// of `capacity` entries that pushes probe without locking. Claiming an entry
+// for a new sender takes a mutex, as does the consumer when it reclaims the
+// entries of senders with nothing queued, which it does once three quarters
+// of the table are claimed. While the table is full, new senders share an
+// overflow sub-queue, and none gets an entry of its own before that has
+// drained, which keeps each sender's messages in order.
+//
+// On every visit a sub-queue earns `quantum` and may send messages for as
+// long as that covers their cost; with the default cost of 1 per message and
+// a quantum of 1 this is plain round robin. The cost function lets the
+// quantum be spent in bytes instead, say.
+//
+// Any number of threads may push; only one may pop.
+class FairMailboxQueue : public IMailboxQueue
+{
+public:
+    using Classifier = std::function<std::uintptr_t (const MessageEnvelope &)>;
+    using Cost = std::function<std::size_t (const Message &)>;
+
+    explicit FairMailboxQueue(std::size_t capacity = 64, std::size_t quantum = 1, Cost &&cost = nullptr, Classifier &&classifier = nullptr)
+        : quantum_{static_cast<std::int64_t>(quantum)}
+        , cost_{std::move(cost)}
+        , classifier_{std::move(classifier)}
+        , entries_(table_size(capacity))
+    {
+    }
+
+    virtual ~FairMailboxQueue()
+    {
+        for (auto &entry : entries_) {
+            delete entry.queue;
+        }
+    }
+
+    virtual bool has_messages() const override
+    {
+        return total_.load() > 0;
+    }
+
+    virtual MessageEnvelope pop() override
+    {
+        if (sweep_.load(std::memory_order_relaxed)) {
+            sweep();
+        }
+        for (;;) {
+            if (!current_) {
+                if (!active_.pop(current_)) {
+                    return MessageEnvelope{};
+                }
+                current_->deficit += quantum_;
+            }
+            auto &queue = *current_;
+            if (!queue.head) {
+                queue.head = queue.messages.pop();
+                if (!queue.head) {
+                    // Counted by a sender that has yet to push it.
+                    rotate();
+                    return MessageEnvelope{};
+                }
+            }
+            auto cost = cost_ ? static_cast<std::int64_t>(cost_(*queue.head.message)) : 1;
+            if (cost > queue.deficit) {
+                rotate();
+                continue;
+            }
+            queue.deficit -= cost;
+            auto envelope = std::move(queue.head);
+            queue.head = MessageEnvelope{};
+            total_.fetch_sub(1);
+            if (queue.count.fetch_sub(1) == 1) {
+                queue.deficit = 0;
+                current_ = nullptr;
+            }
+            return envelope;
+        }
+    }
+
+    virtual bool push(MessageEnvelope envelope) override
+    {
+        Entry *entry = nullptr;
+        std::uint64_t key;
+        auto &queue = key_of(envelope, key) ? sub_queue(key, entry) : anonymous_;
+        total_.fetch_add(1);
+        if (queue.count.fetch_add(1) == 0) {
+            active_.push(&queue);
+        }
+        auto pushed = queue.messages.push(std::move(envelope));
+        if (entry) {
+            entry->users.fetch_sub(1, std::memory_order_release);
+        }
+        return pushed;
+    }
+
+private:
+    class SubQueue
+    {
+    public:
+        UnboundedMailboxQueue messages;
+        // Messages pushed and not yet popped, head included. The sub-queue
+        // is in active_, or current_, while this is non-zero.
+        std::atomic<std::size_t> count{0};
+        // Owned by the consumer.
+        MessageEnvelope head;
+        std::int64_t deficit{0};
+    };
+
+    static const std::uint64_t empty_key = 0;
+    static const std::uint64_t retiring_key = ~std::uint64_t{0} - 1;
+    static const std::uint64_t tombstone_key = ~std::uint64_t{0};
+
+    class Entry
+    {
+    public:
+        std::atomic<std::uint64_t> key{empty_key};
+        // Pushes between finding the entry and being done with its queue;
+        // the entry is only reclaimed while there are none.
+        std::atomic<unsigned> users{0};
+        // Made on the entry's first claim and kept when it is reclaimed.
+        SubQueue *queue{nullptr};
+    };
+
+    static std::size_t table_size(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    // False for messages told from outside any actor. A key that is one of
+    // the reserved ones is moved to the largest free key, at worst sharing
+    // its sub-queue.
+    bool key_of(const MessageEnvelope &envelope, std::uint64_t &key) const
+    {
+        if (classifier_) {
+            key = static_cast<std::uint64_t>(classifier_(envelope));
+        } else if (envelope.header.sender) {
+            key = envelope.header.sender->id();
+        } else if (auto context = LocalContext::current()) {
+            key = context->sender_id();
+        } else {
+            return false;
+        }
+        if (key == empty_key || key >= retiring_key) {
+            key = retiring_key - 1;
+        }
+        return true;
+    }
+
+    std::size_t home(std::uint64_t key) const
+    {
+        return static_cast<std::size_t>(key * 0x9e3779b97f4a7c15ull >> 32) & (entries_.size() - 1);
+    }
+
+    // On return with an entry, the caller is counted in its users.
+    SubQueue &sub_queue(std::uint64_t key, Entry *&entry)
+    {
+        for (;;) {
+            if ((entry = find(key))) {
+                return *entry->queue;
+            }
+            if (!claim(key)) {
+                return overflow_;
+            }
+        }
+    }
+
+    Entry *find(std::uint64_t key)
+    {
+        auto mask = entries_.size() - 1;
+        auto index = home(key);
+        for (std::size_t probe = 0; probe <= mask;) {
+            auto &entry = entries_[index];
+            auto existing = entry.key.load(std::memory_order_acquire);
+            if (existing == retiring_key) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (existing == key) {
+                entry.users.fetch_add(1, std::memory_order_seq_cst);
+                // Reclaimed meanwhile unless still ours.
+                if (entry.key.load(std::memory_order_seq_cst) == key) {
+                    return &entry;
+                }
+                entry.users.fetch_sub(1, std::memory_order_release);
+                continue;
+            }
+            if (existing == empty_key) {
+                return nullptr;
+            }
+            ++probe;
+            index = (index + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    // False when the sender has to use overflow_ instead.
+    bool claim(std::uint64_t key)
+    {
+        if (overflow_.count.load() > 0) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto mask = entries_.size() - 1;
+        auto index = home(key);
+        Entry *free = nullptr;
+        for (std::size_t probe = 0; probe <= mask; ++probe, index = (index + 1) & mask) {
+            auto &entry = entries_[index];
+            auto existing = entry.key.load(std::memory_order_relaxed);
+            if (existing == key) {
+                // Claimed by another pusher with the same key.
+                return true;
+            }
+            if (!free && (existing == empty_key || existing == tombstone_key)) {
+                free = &entry;
+            }
+            if (existing == empty_key) {
+                break;
+            }
+        }
+        if (!free || overflow_.count.load() > 0) {
+            sweep_.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        if (!free->queue) {
+            free->queue = new SubQueue;
+        }
+        if (++claimed_ * 4 >= entries_.size() * 3) {
+            sweep_.store(true, std::memory_order_relaxed);
+        }
+        free->key.store(key, std::memory_order_release);
+        return true;
+    }
+
+    // Gives the entries of senders with nothing queued back. Consumer only.
+    void sweep()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sweep_.store(false, std::memory_order_relaxed);
+        for (auto &entry : entries_) {
+            auto key = entry.key.load(std::memory_order_relaxed);
+            if (key == empty_key || key == tombstone_key || entry.queue->count.load() > 0) {
+                continue;
+            }
+            // Pairs with find(): either a pusher sees the entry retiring or
+            // this sees the pusher among the users.
+            entry.key.store(retiring_key, std::memory_order_seq_cst);
+            if (entry.users.load(std::memory_order_seq_cst) == 0 && entry.queue->count.load() == 0) {
+                entry.key.store(tombstone_key, std::memory_order_release);
+                --claimed_;
+            } else {
+                entry.key.store(key, std::memory_order_release);
+            }
+        }
+    }
+
+    void rotate()
+    {
+        active_.push(current_);
+        current_ = nullptr;
+    }
+
+    std::int64_t quantum_;
+    Cost cost_;
+    Classifier classifier_;
+    std::vector<Entry> entries_;
+    // Guards claiming and reclaiming entries.
+    std::mutex mutex_;
+    std::size_t claimed_{0};
+    std::atomic_bool sweep_{false};
+    SubQueue anonymous_;
+    SubQueue overflow_;
+    // Sub-queues with messages, in visiting order.
+    boost::lockfree::queue<SubQueue *> active_{0};
+    SubQueue *current_{nullptr};
+    std::atomic<std::size_t> total_{0};
+};
+
+class FairMailbox
+{
+public:
+    template <typename... TArgs>
+    static std::shared_ptr<IMailbox> create(TArgs &&...args)
+    {
+        return std::make_shared<DefaultMailbox>(std::make_unique<UnboundedMailboxQueue>(), std::make_unique<FairMailboxQueue>(std::forward<TArgs>(args)...));
+    }
+};
+
+} // namespace mailbox
+} // namespace protoactor
+
+#endif // PROTOACTOR_FAIR_MAILBOX_HPP
@@ -0,0 +1,575 @@
+#ifndef PROTOACTOR_FUTURE_HPP
+#define PROTOACTOR_FUTURE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <protoactor/mailbox.hpp>
+#include <protoactor/types.hpp>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace protoactor
+{
+
+// Value of a Future whose continuation returned void.
+class Unit
+{
+};
+
+class BrokenPromiseException : public std::runtime_error
+{
+public:
+    BrokenPromiseException()
+        : std::runtime_error{"the promise was destroyed without a value"}
+    {
+    }
+};
+
+template <typename T>
+class Future;
+
+template <typename T>
+class FutureState;
+
+template <typename T>
+class FutureCallback
+{
+public:
+    virtual ~FutureCallback() = default;
+    virtual void abandon(FutureState<T> &state) = 0;
+    virtual void fire(FutureState<T> &state) = 0;
+};
+
+// The one allocation behind a Promise/Future pair: an intrusive reference
+// count, the value and at most one callback. Completion is a single atomic
+// exchange; whichever of set_value() and set_callback() comes second runs the
+// callback, so neither side ever blocks. A state that will never get a value
+// is abandoned instead, which lets callbacks drop their references.
+template <typename T>
+class FutureState
+{
+public:
+    FutureState() = default;
+    FutureState(const FutureState &) = delete;
+    FutureState &operator=(const FutureState &) = delete;
+
+    virtual ~FutureState()
+    {
+        if (state_.load(std::memory_order_relaxed) == ready) {
+            value().~T();
+        }
+    }
+
+    void add_ref()
+    {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    bool is_ready() const
+    {
+        return state_.load(std::memory_order_acquire) == ready;
+    }
+
+    bool is_abandoned() const
+    {
+        return state_.load(std::memory_order_acquire) == abandoned;
+    }
+
+    T &value()
+    {
+        return *reinterpret_cast<T *>(&storage_);
+    }
+
+    template <typename... TArgs>
+    void set_value(TArgs &&...args)
+    {
+        new (&storage_) T(std::forward<TArgs>(args)...);
+        if (state_.exchange(ready, std::memory_order_acq_rel) == callback_set) {
+            callback_->fire(*this);
+        }
+    }
+
+    void abandon()
+    {
+        if (state_.exchange(abandoned, std::memory_order_acq_rel) == callback_set) {
+            callback_->abandon(*this);
+        }
+    }
+
+    void set_callback(FutureCallback<T> *callback)
+    {
+        callback_ = callback;
+        int expected = pending;
+        if (!state_.compare_exchange_strong(expected, callback_set, std::memory_order_acq_rel)) {
+            if (expected == ready) {
+                callback->fire(*this);
+            } else {
+                callback->abandon(*this);
+            }
+        }
+    }
+
+private:
+    enum : int
+    {
+        pending,
+        callback_set,
+        ready,
+        abandoned,
+    };
+
+    std::atomic_int refs_{1};
+    std::atomic_int state_{pending};
+    FutureCallback<T> *callback_{nullptr};
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+};
+
+// Blocks Future::wait() until the state is ready or abandoned.
+template <typename T>
+class FutureWaiter : public FutureCallback<T>
+{
+public:
+    virtual void abandon(FutureState<T> &) override
+    {
+        signal();
+    }
+
+    virtual void fire(FutureState<T> &) override
+    {
+        signal();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this]() { return signaled_; });
+    }
+
+private:
+    void signal()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        signaled_ = true;
+        done_.notify_all();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable done_;
+    bool signaled_{false};
+};
+
+template <typename TResult>
+class FutureValue
+{
+public:
+    using type = TResult;
+};
+
+template <>
+class FutureValue<void>
+{
+public:
+    using type = Unit;
+};
+
+// Runs the continuation function and completes the continuation's own state
+// with its result; `source` is the ready state of the future it was attached
+// to. The source reference taken over from that future is released here.
+template <typename T, typename TFunction>
+class ContinuationState : public FutureState<typename FutureValue<typename std::result_of<TFunction(T &&)>::type>::type>, public FutureCallback<T>
+{
+public:
+    using Result = typename std::result_of<TFunction(T &&)>::type;
+    using Value = typename FutureValue<Result>::type;
+
+    ContinuationState(TFunction &&function, mailbox::IDispatcher *dispatcher)
+        : function_(std::move(function))
+        , dispatcher_(dispatcher)
+    {
+    }
+
+    virtual void abandon(FutureState<T> &source) override
+    {
+        source.release();
+        FutureState<Value>::abandon();
+        this->release();
+    }
+
+    virtual void fire(FutureState<T> &source) override
+    {
+        if (!dispatcher_) {
+            return run(source);
+        }
+        auto *self = this;
+        auto *ready = &source;
+        dispatcher_->schedule([self, ready]() {
+            self->run(*ready);
+        });
+    }
+
+private:
+    void run(FutureState<T> &source)
+    {
+        complete(source, std::is_void<Result>{});
+        source.release();
+        this->release();
+    }
+
+    void complete(FutureState<T> &source, std::false_type)
+    {
+        this->set_value(function_(std::move(source.value())));
+    }
+
+    void complete(FutureState<T> &source, std::true_type)
+    {
+        function_(std::move(source.value()));
+        this->set_value();
+    }
+
+    TFunction function_;
+    mailbox::IDispatcher *dispatcher_;
+};
+
+template <typename T>
+class Future
+{
+public:
+    using value_type = T;
+
+    Future() = default;
+
+    explicit Future(FutureState<T> *state)
+        : state_(state)
+    {
+    }
+
+    Future(Future &&other)
+        : state_(other.state_)
+    {
+        other.state_ = nullptr;
+    }
+
+    Future &operator=(Future &&other)
+    {
+        if (this != &other) {
+            reset();
+            state_ = other.state_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~Future()
+    {
+        reset();
+    }
+
+    bool valid() const { return state_ != nullptr; }
+    bool is_ready() const { return state_ && state_->is_ready(); }
+
+    // Blocks until the value is available, or returns false once the promise
+    // is abandoned. Only meant for threads outside of the dispatchers, e.g.
+    // main(); actors should use then() instead. Takes the place of a
+    // continuation, so call then() only after it has returned.
+    bool wait() const
+    {
+        if (!state_->is_ready() && !state_->is_abandoned()) {
+            FutureWaiter<T> waiter;
+            state_->set_callback(&waiter);
+            waiter.wait();
+        }
+        return state_->is_ready();
+    }
+
+    // Waits for and moves out the value, leaving the future invalid. Throws
+    // BrokenPromiseException when the promise is abandoned, or aborts with
+    // PROTOACTOR_NO_EXCEPTIONS.
+    T get()
+    {
+        if (!wait()) {
+            reset();
+            PROTOACTOR_THROW(BrokenPromiseException());
+        }
+        T value{std::move(state_->value())};
+        reset();
+        return value;
+    }
+
+    // Consumes this future. `function` receives the value and runs on
+    // `dispatcher` once it is available; its result completes the returned
+    // future (void results yield Future<Unit>).
+    template <typename TFunction>
+    Future<typename FutureValue<typename std::result_of<TFunction(T &&)>::type>::type> then(mailbox::IDispatcher &dispatcher, TFunction &&function)
+    {
+        return attach(std::forward<TFunction>(function), &dispatcher);
+    }
+
+    // Like then(dispatcher, function), but runs `function` inline on the
+    // thread that completes the value. Keep such continuations short.
+    template <typename TFunction>
+    Future<typename FutureValue<typename std::result_of<TFunction(T &&)>::type>::type> then(TFunction &&function)
+    {
+        return attach(std::forward<TFunction>(function), nullptr);
+    }
+
+    // Hands the state and its reference over to the caller.
+    FutureState<T> *detach()
+    {
+        auto state = state_;
+        state_ = nullptr;
+        return state;
+    }
+
+private:
+    template <typename TFunction>
+    Future<typename FutureValue<typename std::result_of<TFunction(T &&)>::type>::type> attach(TFunction &&function, mailbox::IDispatcher *dispatcher)
+    {
+        using Function = typename std::decay<TFunction>::type;
+        using Result = typename FutureValue<typename std::result_of<TFunction(T &&)>::type>::type;
+        auto continuation = new ContinuationState<T, Function>(Function(std::forward<TFunction>(function)), dispatcher);
+        // One reference for the returned future, one until it has run.
+        continuation->add_ref();
+        Future<Result> result{continuation};
+        detach()->set_callback(continuation);
+        return result;
+    }
+
+    void reset()
+    {
+        if (state_) {
+            state_->release();
+            state_ = nullptr;
+        }
+    }
+
+    FutureState<T> *state_{nullptr};
+};
+
+// A promise that is destroyed without a value abandons its future: wait()
+// returns false, get() fails and continuations are dropped without running.
+template <typename T>
+class Promise
+{
+public:
+    Promise()
+        : state_(new FutureState<T>)
+    {
+    }
+
+    Promise(Promise &&other)
+        : state_(other.state_)
+        , satisfied_(other.satisfied_)
+    {
+        other.state_ = nullptr;
+    }
+
+    Promise &operator=(Promise &&other)
+    {
+        if (this != &other) {
+            reset();
+            state_ = other.state_;
+            satisfied_ = other.satisfied_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~Promise()
+    {
+        reset();
+    }
+
+    // May be called once.
+    Future<T> get_future()
+    {
+        state_->add_ref();
+        return Future<T>{state_};
+    }
+
+    // May be called once.
+    template <typename... TArgs>
+    void set_value(TArgs &&...args)
+    {
+        satisfied_ = true;
+        state_->set_value(std::forward<TArgs>(args)...);
+    }
+
+private:
+    void reset()
+    {
+        if (state_) {
+            if (!satisfied_) {
+                state_->abandon();
+            }
+            state_->release();
+            state_ = nullptr;
+        }
+    }
+
+    FutureState<T> *state_;
+    bool satisfied_{false};
+};
+
+template <typename T, typename... TArgs>
+Future<T> make_ready_future(TArgs &&...args)
+{
+    auto state = new FutureState<T>;
+    state->set_value(std::forward<TArgs>(args)...);
+    return Future<T>{state};
+}
+
+// Completes with all values, in the order of the input futures. T must be
+// default constructible.
+template <typename T>
+class WhenAllState : public FutureState<std::vector<T>>
+{
+public:
+    explicit WhenAllState(std::vector<Future<T>> &futures)
+        : values_(futures.size())
+        , slots_(futures.size())
+        , remaining_(futures.size())
+    {
+        if (futures.empty()) {
+            this->set_value();
+            return;
+        }
+        // One reference per input until it has arrived.
+        for (std::size_t i = 0; i < futures.size(); ++i) {
+            this->add_ref();
+            slots_[i].owner = this;
+            slots_[i].index = i;
+        }
+        for (std::size_t i = 0; i < futures.size(); ++i) {
+            futures[i].detach()->set_callback(&slots_[i]);
+        }
+    }
+
+private:
+    class Slot : public FutureCallback<T>
+    {
+    public:
+        virtual void abandon(FutureState<T> &state) override
+        {
+            state.release();
+            owner->arrive(false);
+        }
+
+        virtual void fire(FutureState<T> &state) override
+        {
+            owner->values_[index] = std::move(state.value());
+            state.release();
+            owner->arrive(true);
+        }
+
+        WhenAllState *owner{nullptr};
+        std::size_t index{0};
+    };
+
+    void arrive(bool has_value)
+    {
+        if (!has_value) {
+            broken_.store(true, std::memory_order_relaxed);
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (broken_.load(std::memory_order_relaxed)) {
+                this->abandon();
+            } else {
+                this->set_value(std::move(values_));
+            }
+        }
+        this->release();
+    }
+
+    std::vector<T> values_;
+    std::vector<Slot> slots_;
+    std::atomic<std::size_t> remaining_;
+    std::atomic_bool broken_{false};
+};
+
+// Completes with the index and value of the first input to complete.
+template <typename T>
+class WhenAnyState : public FutureState<std::pair<std::size_t, T>>
+{
+public:
+    explicit WhenAnyState(std::vector<Future<T>> &futures)
+        : slots_(futures.size())
+        , remaining_(futures.size())
+    {
+        for (std::size_t i = 0; i < futures.size(); ++i) {
+            this->add_ref();
+            slots_[i].owner = this;
+            slots_[i].index = i;
+        }
+        for (std::size_t i = 0; i < futures.size(); ++i) {
+            futures[i].detach()->set_callback(&slots_[i]);
+        }
+    }
+
+private:
+    class Slot : public FutureCallback<T>
+    {
+    public:
+        virtual void abandon(FutureState<T> &state) override
+        {
+            owner->arrive(index, state, false);
+        }
+
+        virtual void fire(FutureState<T> &state) override
+        {
+            owner->arrive(index, state, true);
+        }
+
+        WhenAnyState *owner{nullptr};
+        std::size_t index{0};
+    };
+
+    void arrive(std::size_t index, FutureState<T> &state, bool has_value)
+    {
+        if (has_value && !won_.exchange(true, std::memory_order_acq_rel)) {
+            this->set_value(index, std::move(state.value()));
+        }
+        state.release();
+        // Abandoned only when every input was.
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1 && !won_.load(std::memory_order_acquire)) {
+            this->abandon();
+        }
+        this->release();
+    }
+
+    std::vector<Slot> slots_;
+    std::atomic<std::size_t> remaining_;
+    std::atomic_bool won_{false};
+};
+
+template <typename T>
+Future<std::vector<T>> when_all(std::vector<Future<T>> futures)
+{
+    return Future<std::vector<T>>{new WhenAllState<T>(futures)};
+}
+
+// The returned future is abandoned when `futures` is empty.
+template <typename T>
+Future<std::pair<std::size_t, T>> when_any(std::vector<Future<T>> futures)
+{
+    auto state = new WhenAnyState<T>(futures);
+    if (futures.empty()) {
+        state->abandon();
+    }
+    return Future<std::pair<std::size_t, T>>{state};
+}
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_FUTURE_HPP
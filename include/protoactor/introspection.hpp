@@ -0,0 +1,148 @@
+#ifndef PROTOACTOR_INTROSPECTION_HPP
+#define PROTOACTOR_INTROSPECTION_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <protoactor/protoactor.hpp>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace protoactor
+{
+
+inline const char *to_string(ContextState state)
+{
+    switch (state) {
+    case ContextState::None:
+        return "none";
+    case ContextState::Dormant:
+        return "dormant";
+    case ContextState::Alive:
+        return "alive";
+    case ContextState::Restarting:
+        return "restarting";
+    case ContextState::Stopping:
+        return "stopping";
+    }
+    return "unknown";
+}
+
+class ActorInfo
+{
+public:
+    std::string id;
+    // "local" for spawned actors, "process" for any other registered process.
+    const char *kind{"process"};
+    std::size_t mailbox_depth{0};
+    ContextState state{ContextState::None};
+    // RuntimeClock::coarse_now() time of the last processed message.
+    std::int64_t last_activity{0};
+};
+
+class RuntimeSnapshot
+{
+public:
+    std::size_t actors{0};
+    std::size_t queued_messages{0};
+    // Indexed by ContextState.
+    std::array<std::size_t, 5> states{};
+    // Deepest mailboxes first.
+    std::vector<ActorInfo> deepest;
+};
+
+// Reads the state of every registered process without pausing the runtime:
+// registry shards are copied one at a time under their own lock and
+// everything else is read from relaxed atomics. The result is therefore not
+// a consistent cut; actors spawned or stopped during a walk may or may not
+// show up.
+class Introspection
+{
+public:
+    using Visitor = std::function<void (const ActorInfo &)>;
+
+    static void for_each(const Visitor &visitor, ProcessRegistry &registry = ProcessRegistry::instance())
+    {
+        ProcessRegistry::Entries entries;
+        for (std::size_t shard = 0; shard < registry.shards(); ++shard) {
+            entries.clear();
+            registry.copy_shard(shard, entries);
+            for (auto &entry : entries) {
+                visitor(describe(entry.first, *entry.second));
+            }
+        }
+    }
+
+    // Counts everything and keeps the `top_k` deepest mailboxes in one pass,
+    // with a min-heap of at most `top_k` entries.
+    static RuntimeSnapshot snapshot(std::size_t top_k = 10, ProcessRegistry &registry = ProcessRegistry::instance())
+    {
+        auto shallower = [](const ActorInfo &a, const ActorInfo &b) {
+            return a.mailbox_depth > b.mailbox_depth;
+        };
+        std::priority_queue<ActorInfo, std::vector<ActorInfo>, decltype(shallower)> deepest(shallower);
+        RuntimeSnapshot snapshot;
+        for_each([&](const ActorInfo &info) {
+            ++snapshot.actors;
+            snapshot.queued_messages += info.mailbox_depth;
+            ++snapshot.states[static_cast<std::size_t>(info.state)];
+            if (top_k == 0) {
+                return;
+            }
+            if (deepest.size() < top_k) {
+                deepest.push(info);
+            } else if (info.mailbox_depth > deepest.top().mailbox_depth) {
+                deepest.pop();
+                deepest.push(info);
+            }
+        }, registry);
+        snapshot.deepest.reserve(deepest.size());
+        while (!deepest.empty()) {
+            snapshot.deepest.push_back(deepest.top());
+            deepest.pop();
+        }
+        std::reverse(snapshot.deepest.begin(), snapshot.deepest.end());
+        return snapshot;
+    }
+
+    static void dump(std::ostream &out, const RuntimeSnapshot &snapshot)
+    {
+        out << "actors " << snapshot.actors << ", queued messages " << snapshot.queued_messages << '\n';
+        for (std::size_t state = 0; state < snapshot.states.size(); ++state) {
+            if (snapshot.states[state]) {
+                out << "  " << to_string(static_cast<ContextState>(state)) << ' ' << snapshot.states[state] << '\n';
+            }
+        }
+        auto now = RuntimeClock::instance().coarse_now();
+        for (auto &info : snapshot.deepest) {
+            out << "  " << info.id << ' ' << info.kind << " depth " << info.mailbox_depth << ' ' << to_string(info.state)
+                << " idle " << (now - info.last_activity) / 1000000 << "ms" << '\n';
+        }
+    }
+
+private:
+    static ActorInfo describe(const std::string &id, const Process &process)
+    {
+        ActorInfo info;
+        info.id = id;
+        auto local = dynamic_cast<const LocalProcess *>(&process);
+        if (!local) {
+            return info;
+        }
+        info.kind = "local";
+        info.mailbox_depth = local->mailbox()->depth();
+        if (auto context = local->context()) {
+            info.state = context->state();
+            info.last_activity = context->last_activity();
+        }
+        return info;
+    }
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_INTROSPECTION_HPP
@@ -1,13 +1,22 @@
 #ifndef PROTOACTOR_MAILBOX_HPP
 #define PROTOACTOR_MAILBOX_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <boost/lockfree/queue.hpp>
+#include <cstddef>
 #include <exception>
 #include <functional>
 #include <memory>
+#include <protoactor/clock.hpp>
+#include <protoactor/recycler.hpp>
 #include <protoactor/types.hpp>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 namespace protoactor
 {
 namespace mailbox
@@ -15,20 +24,62 @@ namespace mailbox
 
 class IMessageInvoker;
 
+// Dispatchers that support it run higher classes first, with aging so that
+// lower ones are not starved.
+enum class SchedulePriority
+{
+    Low,
+    Normal,
+    High,
+};
+
+class ScheduleHint
+{
+public:
+    int worker{-1};
+    SchedulePriority priority{SchedulePriority::Normal};
+};
+
 class IDispatcher
 {
 public:
     virtual ~IDispatcher() = default;
     virtual void schedule(const std::function<void ()> &runner) = 0;
+
+    virtual void schedule(const std::function<void ()> &runner, const ScheduleHint &)
+    {
+        schedule(runner);
+    }
+
+    // Schedules `count` runners, each with its hint. Dispatchers override it
+    // to enqueue them together and wake workers once.
+    virtual void schedule_batch(const std::function<void ()> *runners, const ScheduleHint *hints, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            schedule(runners[i], hints[i]);
+        }
+    }
+
     virtual int throughput() const = 0;
+
+    // How many times, at most, a mailbox that has run dry polls for its next
+    // message before going idle, keeping the worker busy meanwhile; 0 never
+    // polls. Not for dispatchers that run mailboxes on the posting thread.
+    virtual int max_linger() const
+    {
+        return 0;
+    }
 };
 
 class SynchronousDispatcher : public IDispatcher
 {
 public:
+    using IDispatcher::schedule;
+
     virtual void schedule(const std::function<void ()> &runner) override
     {
         runner();
+        RuntimeClock::instance().update();
     }
 
     virtual int throughput() const override
@@ -37,6 +88,89 @@ public:
     }
 };
 
+// While one is open on a thread, the mailboxes that thread schedules are
+// collected rather than scheduled, and handed to each dispatcher in a single
+// schedule_batch() when the outermost open ScheduleBatch is destroyed. Meant
+// for fan-out, e.g.
+//
+//     {
+//         ScheduleBatch batch;
+//         for (auto &pid : subscribers) {
+//             pid.tell(...);
+//         }
+//     }
+//
+// Nothing collected runs before then, so do not wait inside one for an
+// actor to act.
+class ScheduleBatch
+{
+public:
+    ScheduleBatch()
+    {
+        if (!current()) {
+            current() = this;
+        }
+    }
+
+    ~ScheduleBatch()
+    {
+        if (current() == this) {
+            current() = nullptr;
+            flush();
+        }
+    }
+
+    ScheduleBatch(const ScheduleBatch &) = delete;
+    ScheduleBatch &operator=(const ScheduleBatch &) = delete;
+
+    // Takes `runner` and returns true if a batch is open on the calling
+    // thread; otherwise leaves it alone and returns false.
+    static bool add(IDispatcher &dispatcher, std::function<void ()> &&runner, const ScheduleHint &hint)
+    {
+        auto batch = current();
+        if (!batch) {
+            return false;
+        }
+        batch->dispatchers_.push_back(&dispatcher);
+        batch->runners_.push_back(std::move(runner));
+        batch->hints_.push_back(hint);
+        return true;
+    }
+
+private:
+    static ScheduleBatch *&current()
+    {
+        static thread_local ScheduleBatch *_current{nullptr};
+        return _current;
+    }
+
+    // Usually everything is for one dispatcher; otherwise each gets its own
+    // runners in one call.
+    void flush()
+    {
+        auto count = runners_.size();
+        std::size_t done = 0;
+        while (done < count) {
+            auto dispatcher = dispatchers_[done];
+            std::size_t kept = done;
+            for (auto i = done; i < count; ++i) {
+                if (dispatchers_[i] == dispatcher) {
+                    std::swap(runners_[kept], runners_[i]);
+                    std::swap(hints_[kept], hints_[i]);
+                    std::swap(dispatchers_[kept], dispatchers_[i]);
+                    ++kept;
+                }
+            }
+            dispatcher->schedule_batch(runners_.data() + done, hints_.data() + done, kept - done);
+            done = kept;
+        }
+    }
+
+    std::vector<IDispatcher *> dispatchers_;
+    std::vector<std::function<void ()>> runners_;
+    std::vector<ScheduleHint> hints_;
+};
+
 class Dispatchers
 {
 public:
@@ -51,9 +185,27 @@ class IMailbox
 {
 public:
     virtual ~IMailbox() = default;
+    // Messages posted but not yet processed. Approximate while messages are
+    // in flight; meant for monitoring.
+    virtual std::size_t depth() const = 0;
     virtual void post_system_message(Message::UPtr message) = 0;
-    virtual void post_user_message(Message::UPtr message) = 0;
+    virtual void post_user_message(MessageEnvelope envelope) = 0;
+
+    // Moves `count` messages out of `envelopes`, in order.
+    virtual void post_user_messages(MessageEnvelope *envelopes, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            post_user_message(std::move(envelopes[i]));
+        }
+    }
     virtual void register_handlers(const std::shared_ptr<IMessageInvoker> &invoker, IDispatcher &dispatcher) = 0;
+    // The dispatcher given to register_handlers(), or nullptr before that.
+    // May be read from any thread.
+    virtual IDispatcher *dispatcher() const = 0;
+    virtual void set_affinity(int worker) = 0;
+    virtual void set_priority(SchedulePriority priority) = 0;
+    // Messages posted before start() are only queued; start() runs them all
+    // in one go.
     virtual void start() = 0;
 };
 
@@ -62,8 +214,9 @@ class IMailboxQueue
 public:
     virtual ~IMailboxQueue() = default;
     virtual bool has_messages() const = 0;
-    virtual Message::UPtr pop() = 0;
-    virtual void push(Message::UPtr message) = 0;
+    virtual MessageEnvelope pop() = 0;
+    // Returns false, having dropped the message, when the queue refuses it.
+    virtual bool push(MessageEnvelope envelope) = 0;
 };
 
 class IMailboxStatistics
@@ -80,11 +233,34 @@ class IMessageInvoker
 {
 public:
     virtual ~IMessageInvoker() = default;
-    virtual void escalate_failure(const std::exception &reason, const Message::SPtr &message) = 0;
-    virtual void invoke_system_message(const Message::SPtr &message) = 0;
-    virtual void invoke_user_message(const Message::SPtr &message) = 0;
+    // `reason` is only valid for the duration of the call.
+    virtual void escalate_failure(const Status &reason, const Message::SPtr &message) = 0;
+    virtual Status invoke_system_message(const Message::SPtr &message) = 0;
+    virtual Status invoke_user_message(const Message::SPtr &message, const MessageHeader &header) = 0;
 };
 
+// Runs `invoke` for one message and escalates its failure, whether returned
+// or, unless built with PROTOACTOR_NO_EXCEPTIONS, thrown; either way the
+// next message is processed as usual.
+template <typename TInvoke>
+void invoke_guarded(IMessageInvoker &invoker, const Message::SPtr &message, TInvoke &&invoke)
+{
+#ifdef PROTOACTOR_NO_EXCEPTIONS
+    auto status = invoke();
+#else
+    Status status;
+    try
+    {
+        status = invoke();
+    } catch (const std::exception &e) {
+        return invoker.escalate_failure(Status{e.what()}, message);
+    }
+#endif
+    if (!status) {
+        invoker.escalate_failure(status, message);
+    }
+}
+
 enum class MailboxStatus
 {
     Idle = false,
@@ -108,7 +284,7 @@ class SuspendMailboxMessage : public SystemMessage
 {
 };
 
-class DefaultMailbox : public IMailbox
+class DefaultMailbox : public IMailbox, public std::enable_shared_from_this<DefaultMailbox>
 {
 public:
     template <typename... TMailboxStatistics>
@@ -119,28 +295,69 @@ public:
     {
     }
 
+    virtual std::size_t depth() const override
+    {
+        // processed_ is read first, so it can never be ahead of posted_.
+        auto processed = processed_.load(std::memory_order_relaxed);
+        return posted_.load(std::memory_order_relaxed) - processed;
+    }
+
     virtual void post_system_message(Message::UPtr message) override
     {
         for (auto &stat : stats_) {
             stat->message_posted(*message);
         }
+        posted_.fetch_add(1, std::memory_order_relaxed);
         system_messages_->push(std::move(message));
         schedule();
     }
 
-    virtual void post_user_message(Message::UPtr message) override
+    virtual void post_user_message(MessageEnvelope envelope) override
     {
         for (auto &stat : stats_) {
-            stat->message_posted(*message);
+            stat->message_posted(*envelope.message);
+        }
+        posted_.fetch_add(1, std::memory_order_relaxed);
+        if (!user_mailbox_->push(std::move(envelope))) {
+            posted_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        schedule();
+    }
+
+    // Schedules once for the whole batch.
+    virtual void post_user_messages(MessageEnvelope *envelopes, std::size_t count) override
+    {
+        posted_.fetch_add(count, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < count; ++i) {
+            for (auto &stat : stats_) {
+                stat->message_posted(*envelopes[i].message);
+            }
+            if (!user_mailbox_->push(std::move(envelopes[i]))) {
+                posted_.fetch_sub(1, std::memory_order_relaxed);
+            }
         }
-        user_mailbox_->push(std::move(message));
         schedule();
     }
 
     virtual void register_handlers(const std::shared_ptr<IMessageInvoker> &invoker, IDispatcher &dispatcher) override
     {
         invoker_ = invoker;
-        dispatcher_ = &dispatcher;
+        dispatcher_.store(&dispatcher, std::memory_order_relaxed);
+    }
+
+    virtual IDispatcher *dispatcher() const override
+    {
+        return dispatcher_.load(std::memory_order_relaxed);
+    }
+
+    virtual void set_affinity(int worker) override
+    {
+        affinity_.store(worker, std::memory_order_relaxed);
+    }
+
+    virtual void set_priority(SchedulePriority priority) override
+    {
+        priority_.store(priority, std::memory_order_relaxed);
     }
 
     virtual void start() override
@@ -148,68 +365,181 @@ public:
         for (auto &stat : stats_) {
             stat->mailbox_started();
         }
+        status_.store(MailboxStatus::Idle);
+        if (system_messages_->has_messages() || user_mailbox_->has_messages()) {
+            schedule();
+        }
+    }
+
+    // Returns the mailbox to its freshly constructed state, dropping any
+    // queued messages, statistics and handlers, so that it can be reused.
+    void recycle()
+    {
+        while (system_messages_->pop()) {
+        }
+        while (user_mailbox_->pop()) {
+        }
+        stats_.clear();
+        posted_.store(0, std::memory_order_relaxed);
+        processed_.store(0, std::memory_order_relaxed);
+        invoker_.reset();
+        dispatcher_.store(nullptr, std::memory_order_relaxed);
+        affinity_.store(-1, std::memory_order_relaxed);
+        priority_.store(SchedulePriority::Normal, std::memory_order_relaxed);
+        status_.store(MailboxStatus::Busy);
+        suspended_.store(false, std::memory_order_relaxed);
+        linger_window_ = -1;
+        linger_skips_ = 0;
     }
 
 protected:
-    void schedule()
+    // Returns false if the mailbox was already scheduled or running.
+    bool schedule()
     {
         MailboxStatus expected{MailboxStatus::Idle};
-        if (status_.compare_exchange_strong(expected, MailboxStatus::Busy)) {
-            dispatcher_->schedule([this]() {
-                run();
-            });
+        if (!status_.compare_exchange_strong(expected, MailboxStatus::Busy)) {
+            return false;
         }
+        ScheduleHint hint;
+        hint.worker = affinity_.load(std::memory_order_relaxed);
+        hint.priority = priority_.load(std::memory_order_relaxed);
+        auto self = shared_from_this();
+        std::function<void ()> runner = [self]() {
+            self->run();
+        };
+        auto dispatcher = this->dispatcher();
+        if (!ScheduleBatch::add(*dispatcher, std::move(runner), hint)) {
+            dispatcher->schedule(runner, hint);
+        }
+        return true;
+    }
+
+    // Called on the thread running the mailbox for every system message,
+    // after suspension has been updated for it and before it is invoked.
+    virtual void system_message_received(const Message &)
+    {
+    }
+
+    // May be read from any thread; only the thread running the mailbox
+    // suspends it.
+    bool suspended() const
+    {
+        return suspended_.load(std::memory_order_relaxed);
+    }
+
+    void suspend()
+    {
+        suspended_.store(true, std::memory_order_relaxed);
+    }
+
+    const IMailboxQueue &user_messages() const
+    {
+        return *user_mailbox_;
     }
 
 private:
     using Stats = std::vector<std::unique_ptr<IMailboxStatistics>>;
 
-    bool process_messages()
+    static void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    // Returns how many messages were processed, out of at most `budget`.
+    int process_messages(int budget)
     {
         Message::SPtr message;
-        try
-        {
-            for (auto i = 0; i < dispatcher_->throughput(); ++i) {
-                message = system_messages_->pop();
-                if (message) {
-                    if (dynamic_cast<SuspendMailboxMessage *>(message.get())) {
-                        suspended_ = true;
-                    } else if (dynamic_cast<ResumeMailboxMessage *>(message.get())) {
-                        suspended_ = false;
-                    }
-                    invoker_->invoke_system_message(message);
-                    for (auto &stat : stats_) {
-                        stat->message_received(*message);
-                    }
-                    continue;
+        auto i = 0;
+        for (; i < budget; ++i) {
+            message = std::move(system_messages_->pop().message);
+            if (message) {
+                count_processed();
+                if (dynamic_cast<SuspendMailboxMessage *>(message.get())) {
+                    suspend();
+                } else if (dynamic_cast<ResumeMailboxMessage *>(message.get())) {
+                    suspended_.store(false, std::memory_order_relaxed);
                 }
-                if (suspended_) {
-                    break;
+                system_message_received(*message);
+                invoke_guarded(*invoker_, message, [&]() {
+                    return invoker_->invoke_system_message(message);
+                });
+                for (auto &stat : stats_) {
+                    stat->message_received(*message);
                 }
-                message = user_mailbox_->pop();
-                if (message) {
-                    invoker_->invoke_user_message(message);
-                    for (auto &stat : stats_) {
-                        stat->message_received(*message);
-                    }
-                } else {
-                    break;
+                continue;
+            }
+            if (suspended()) {
+                break;
+            }
+            auto envelope = user_mailbox_->pop();
+            if (envelope) {
+                count_processed();
+                message = std::move(envelope.message);
+                invoke_guarded(*invoker_, message, [&]() {
+                    return invoker_->invoke_user_message(message, envelope.header);
+                });
+                for (auto &stat : stats_) {
+                    stat->message_received(*message);
                 }
+            } else {
+                break;
             }
-        } catch (const std::exception &e) {
-            invoker_->escalate_failure(e, message);
         }
-        return true;
+        return i;
     }
 
-    void run()
+    // Called when the queues looked empty. Polls for up to the current
+    // window and returns true, still Busy, if a message arrived meanwhile,
+    // which saves a reschedule for request/response traffic. The window is
+    // twice the last gap caught, at least 32 polls and at most max_linger(),
+    // and halves on every miss; once it reaches zero, every 16th idle
+    // transition probes with an eighth of the maximum, so that lingering
+    // resumes when traffic does.
+    bool linger()
     {
-        auto done = process_messages();
-        if (!done) {
-            return;
+        auto max = dispatcher()->max_linger();
+        if (max <= 0 || suspended()) {
+            return false;
+        }
+        if (linger_window_ < 0) {
+            linger_window_ = max;
+        }
+        auto window = linger_window_;
+        if (window == 0) {
+            if (++linger_skips_ % 16 != 0) {
+                return false;
+            }
+            window = std::max(max / 8, 1);
+        }
+        for (auto polls = 1; polls <= window; ++polls) {
+            cpu_relax();
+            if (system_messages_->has_messages() || user_mailbox_->has_messages()) {
+                linger_window_ = std::min(max, std::max(2 * polls, 32));
+                return true;
+            }
         }
+        linger_window_ /= 2;
+        return false;
+    }
+
+    // Only ever called by the thread running the mailbox.
+    void count_processed()
+    {
+        processed_.store(processed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Lingering only spends what is left of the throughput budget, so a
+    // mailbox never holds its worker for more messages than without it.
+    void run()
+    {
+        auto budget = dispatcher()->throughput();
+        do {
+            budget -= process_messages(budget);
+        } while (budget > 0 && linger());
         status_.store(MailboxStatus::Idle);
-        if (system_messages_->has_messages() || (!suspended_ && user_mailbox_->has_messages())) {
+        if (system_messages_->has_messages() || (!suspended() && user_mailbox_->has_messages())) {
             schedule();
         } else {
             for (auto &stat : stats_) {
@@ -218,11 +548,19 @@ private:
         }
     }
 
-    IDispatcher *dispatcher_{nullptr};
+    std::atomic_int affinity_{-1};
+    std::atomic<SchedulePriority> priority_{SchedulePriority::Normal};
+    std::atomic<std::size_t> posted_{0};
+    std::atomic<std::size_t> processed_{0};
+    std::atomic<IDispatcher *> dispatcher_{nullptr};
     std::shared_ptr<IMessageInvoker> invoker_;
     Stats stats_;
-    std::atomic<MailboxStatus> status_{MailboxStatus::Idle};
-    bool suspended_{false};
+    // Busy until start(), so that nothing is scheduled before.
+    std::atomic<MailboxStatus> status_{MailboxStatus::Busy};
+    std::atomic_bool suspended_{false};
+    // Polls, adapted by linger(); -1 until first used.
+    int linger_window_{-1};
+    unsigned linger_skips_{0};
     std::unique_ptr<IMailboxQueue> system_messages_;
     std::unique_ptr<IMailboxQueue> user_mailbox_;
 };
@@ -239,20 +577,39 @@ public:
 
     virtual bool has_messages() const override { return !messages_.empty(); }
 
-    virtual Message::UPtr pop() override
+    virtual MessageEnvelope pop() override
     {
-        Message::UPtr message;
-        messages_.pop(message);
-        return message;
+        Slot slot;
+        if (!messages_.pop(slot)) {
+            return MessageEnvelope{};
+        }
+        MessageEnvelope envelope{Message::UPtr{slot.message}};
+        envelope.header.sender = SenderRef::adopt(slot.sender);
+        envelope.header.trace_id = slot.trace_id;
+        envelope.header.deadline = slot.deadline;
+        return envelope;
     }
 
-    virtual void push(Message::UPtr message) override
+    virtual bool push(MessageEnvelope envelope) override
     {
-        messages_.push(message.release());
+        auto &header = envelope.header;
+        messages_.push(Slot{envelope.message.release(), header.sender.release(), header.trace_id, header.deadline});
+        return true;
     }
 
 private:
-    using Messages = boost::lockfree::queue<Message *>;
+    // Trivially copyable, as boost::lockfree::queue requires: the message and
+    // the sender reference are owned by the slot while queued.
+    class Slot
+    {
+    public:
+        Message *message;
+        Sender *sender;
+        std::uint64_t trace_id;
+        std::int64_t deadline;
+    };
+
+    using Messages = boost::lockfree::queue<Slot>;
 
     Messages messages_{0};
 };
@@ -261,9 +618,25 @@ class UnboundedMailbox
 {
 public:
     template <typename... TMailboxStatistics>
-    static std::unique_ptr<IMailbox> create(TMailboxStatistics &&...stats)
+    static std::shared_ptr<IMailbox> create(TMailboxStatistics &&...stats)
+    {
+        return std::make_shared<DefaultMailbox>(std::make_unique<UnboundedMailboxQueue>(), std::make_unique<UnboundedMailboxQueue>(), std::forward<TMailboxStatistics>(stats)...);
+    }
+
+    // Like create() without statistics, but reuses a previously released
+    // mailbox (queues included) when one is available.
+    static std::shared_ptr<IMailbox> acquire()
     {
-        return std::make_unique<DefaultMailbox>(std::make_unique<UnboundedMailboxQueue>(), std::make_unique<UnboundedMailboxQueue>(), std::forward<TMailboxStatistics>(stats)...);
+        auto mailbox = Recycler<DefaultMailbox>::instance().pop();
+        if (!mailbox) {
+            mailbox = new DefaultMailbox(std::make_unique<UnboundedMailboxQueue>(), std::make_unique<UnboundedMailboxQueue>());
+        }
+        return std::shared_ptr<DefaultMailbox>(mailbox, [](DefaultMailbox *released) {
+            released->recycle();
+            if (!Recycler<DefaultMailbox>::instance().push(released)) {
+                delete released;
+            }
+        });
     }
 };
 
@@ -0,0 +1,450 @@
+#ifndef PROTOACTOR_MEMORY_BUDGET_HPP
+#define PROTOACTOR_MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <protoactor/codec.hpp>
+#include <protoactor/mailbox.hpp>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace protoactor
+{
+namespace mailbox
+{
+
+// One budget for the bytes held by every BudgetedMailboxQueue.
+//
+// Queues charge and release on whatever thread pushes or pops, into a
+// thread-local balance that only reaches the shared counter in steps of
+// flush_threshold bytes, so accounting costs no shared write per message;
+// used() is accurate to within that step per thread.
+//
+// Below the limit every message is admitted. Between the limit and the limit
+// plus the headroom only queues holding less than the average non-empty
+// queue still are, so that quiet actors keep working while backed-up ones
+// are cut off. Beyond that nothing is admitted. What "not admitted" means is
+// up to the queue: rejection, or spilling when it has an ISpillStore.
+//
+// Only queued messages are counted, as estimated by the sizer; leave room
+// for the rest of the process when choosing the limit.
+class MemoryBudget
+{
+public:
+    using Sizer = std::function<std::size_t (const Message &)>;
+
+    static const std::int64_t flush_threshold = 16 * 1024;
+
+    static MemoryBudget &instance()
+    {
+        static MemoryBudget _instance;
+        return _instance;
+    }
+
+    void set_limit(std::size_t limit, std::size_t headroom = 0)
+    {
+        limit_.store(static_cast<std::int64_t>(limit), std::memory_order_relaxed);
+        headroom_.store(static_cast<std::int64_t>(headroom), std::memory_order_relaxed);
+    }
+
+    // Estimates the bytes a queued message holds. Without one every message
+    // counts as default_message_size bytes. Queues call it without locking,
+    // so it may only be set while no BudgetedMailboxQueue exists.
+    void set_sizer(Sizer &&sizer)
+    {
+        if (queues_.load() > 0) {
+            PROTOACTOR_THROW(std::logic_error("MemoryBudget::set_sizer with budgeted queues in use"));
+        }
+        sizer_ = std::move(sizer);
+    }
+
+    std::size_t size_of(const Message &message) const
+    {
+        return sizer_ ? sizer_(message) : default_message_size;
+    }
+
+    std::int64_t used() const
+    {
+        return used_.load(std::memory_order_relaxed) + local().bytes;
+    }
+
+    std::uint64_t rejected() const
+    {
+        return rejected_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t spilled() const
+    {
+        return spilled_.load(std::memory_order_relaxed);
+    }
+
+    // Spilled messages that could not be read back.
+    std::uint64_t lost() const
+    {
+        return lost_.load(std::memory_order_relaxed);
+    }
+
+    bool admit(std::size_t queue_bytes, std::size_t size) const
+    {
+        auto used = this->used() + static_cast<std::int64_t>(size);
+        auto limit = limit_.load(std::memory_order_relaxed);
+        if (used <= limit) {
+            return true;
+        }
+        if (used > limit + headroom_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        auto active = active_queues_.load(std::memory_order_relaxed);
+        return active <= 0 || static_cast<std::int64_t>(queue_bytes) * active < used;
+    }
+
+    void charge(std::size_t bytes)
+    {
+        auto &pending = local();
+        pending.bytes += static_cast<std::int64_t>(bytes);
+        if (pending.bytes >= flush_threshold) {
+            pending.flush();
+        }
+    }
+
+    void release(std::size_t bytes)
+    {
+        auto &pending = local();
+        pending.bytes -= static_cast<std::int64_t>(bytes);
+        if (pending.bytes <= -flush_threshold) {
+            pending.flush();
+        }
+    }
+
+    void queue_activated()
+    {
+        active_queues_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void queue_drained()
+    {
+        active_queues_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void count_rejected()
+    {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void count_spilled()
+    {
+        spilled_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void count_lost(std::size_t count)
+    {
+        lost_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void queue_created()
+    {
+        queues_.fetch_add(1);
+    }
+
+    void queue_destroyed()
+    {
+        queues_.fetch_sub(1);
+    }
+
+private:
+    static const std::size_t default_message_size = 64;
+
+    // Flushed when its thread exits, too.
+    class Pending
+    {
+    public:
+        ~Pending()
+        {
+            flush();
+        }
+
+        void flush()
+        {
+            MemoryBudget::instance().used_.fetch_add(bytes, std::memory_order_relaxed);
+            bytes = 0;
+        }
+
+        std::int64_t bytes{0};
+    };
+
+    MemoryBudget() = default;
+
+    static Pending &local()
+    {
+        static thread_local Pending _pending;
+        return _pending;
+    }
+
+    std::atomic<std::int64_t> used_{0};
+    std::atomic<std::int64_t> limit_{std::numeric_limits<std::int64_t>::max() / 2};
+    std::atomic<std::int64_t> headroom_{0};
+    std::atomic<std::int64_t> active_queues_{0};
+    std::atomic<std::uint64_t> rejected_{0};
+    std::atomic<std::uint64_t> spilled_{0};
+    std::atomic<std::uint64_t> lost_{0};
+    std::atomic<std::int64_t> queues_{0};
+    Sizer sizer_;
+};
+
+// Where a BudgetedMailboxQueue puts the messages the budget does not admit.
+// Used by one queue only; push() may be called from any thread, pop() and
+// take_lost() from the one consuming the queue.
+class ISpillStore
+{
+public:
+    virtual ~ISpillStore() = default;
+    virtual MessageEnvelope pop() = 0;
+    virtual void push(MessageEnvelope envelope) = 0;
+
+    // Messages dropped as unreadable since the last call.
+    virtual std::size_t take_lost()
+    {
+        return 0;
+    }
+};
+
+// Spills to an append-only file through user supplied (de)serializers, as
+// records of varint length, trace id, deadline and payload. The sender is not
+// kept. The file is removed on destruction and rewritten from the start
+// whenever it has been read to the end. A record that cannot be read, or
+// that the deserializer returns nullptr for, is lost, and so is everything
+// behind a corrupt one.
+class FileSpillStore : public ISpillStore
+{
+public:
+    using Serializer = std::function<std::string (const Message &)>;
+    using Deserializer = std::function<Message::UPtr (const std::string &)>;
+
+    FileSpillStore(const std::string &path, Serializer &&serializer, Deserializer &&deserializer)
+        : path_{path}
+        , serializer_{std::move(serializer)}
+        , deserializer_{std::move(deserializer)}
+        , file_{std::fopen(path.c_str(), "w+b")}
+    {
+        if (!file_) {
+            PROTOACTOR_THROW(std::runtime_error("cannot open spill file " + path));
+        }
+    }
+
+    ~FileSpillStore()
+    {
+        std::fclose(file_);
+        std::remove(path_.c_str());
+    }
+
+    virtual MessageEnvelope pop() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (read_offset_ == write_offset_) {
+            return MessageEnvelope{};
+        }
+        std::fseek(file_, read_offset_, SEEK_SET);
+        std::uint64_t size = 0;
+        MessageEnvelope envelope;
+        std::uint64_t deadline = 0;
+        std::string payload;
+        if (!read_varint(size) || !read_varint(envelope.header.trace_id) || !read_varint(deadline) || size > static_cast<std::uint64_t>(write_offset_ - std::ftell(file_))) {
+            discard();
+            return MessageEnvelope{};
+        }
+        envelope.header.deadline = codec::zigzag_decode(deadline);
+        payload.resize(size);
+        if (size && std::fread(&payload[0], 1, size, file_) != size) {
+            discard();
+            return MessageEnvelope{};
+        }
+        --records_;
+        read_offset_ = std::ftell(file_);
+        if (read_offset_ == write_offset_) {
+            read_offset_ = write_offset_ = 0;
+        }
+        lock.unlock();
+        envelope.message = deserializer_(payload);
+        if (!envelope.message) {
+            lock.lock();
+            ++lost_;
+        }
+        return envelope;
+    }
+
+    virtual void push(MessageEnvelope envelope) override
+    {
+        auto payload = serializer_(*envelope.message);
+        std::uint8_t prefix[3 * 10];
+        auto end = codec::Varint::encode(payload.size(), prefix);
+        end = codec::Varint::encode(envelope.header.trace_id, end);
+        end = codec::Varint::encode(codec::zigzag_encode(envelope.header.deadline), end);
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::fseek(file_, write_offset_, SEEK_SET);
+        std::fwrite(prefix, 1, static_cast<std::size_t>(end - prefix), file_);
+        std::fwrite(payload.data(), 1, payload.size(), file_);
+        std::fflush(file_);
+        write_offset_ = std::ftell(file_);
+        ++records_;
+    }
+
+    virtual std::size_t take_lost() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto lost = lost_;
+        lost_ = 0;
+        return lost;
+    }
+
+private:
+    bool read_varint(std::uint64_t &value)
+    {
+        std::uint8_t bytes[10];
+        std::size_t size = 0;
+        int c;
+        do {
+            c = std::fgetc(file_);
+            if (c == EOF || size == sizeof(bytes)) {
+                return false;
+            }
+            bytes[size++] = static_cast<std::uint8_t>(c);
+        } while (c & 0x80);
+        return codec::Varint::decode(bytes, bytes + size, value) != nullptr;
+    }
+
+    // Nothing behind a corrupt record can be found again.
+    void discard()
+    {
+        lost_ += records_;
+        records_ = 0;
+        read_offset_ = write_offset_ = 0;
+    }
+
+    std::string path_;
+    Serializer serializer_;
+    Deserializer deserializer_;
+    std::FILE *file_;
+    std::mutex mutex_;
+    long read_offset_{0};
+    long write_offset_{0};
+    // Written and not yet read back.
+    std::size_t records_{0};
+    std::size_t lost_{0};
+};
+
+// Decorates a queue with MemoryBudget accounting. Messages the budget does
+// not admit are rejected or, with a spill store, spilled; once anything is
+// spilled, later messages follow it there until it is drained, which keeps
+// each sender's messages in order. Spilled messages the store loses are
+// counted by MemoryBudget::lost() and skipped.
+class BudgetedMailboxQueue : public IMailboxQueue
+{
+public:
+    BudgetedMailboxQueue(std::unique_ptr<IMailboxQueue> queue, std::shared_ptr<ISpillStore> spill = nullptr)
+        : budget_(MemoryBudget::instance())
+        , queue_{std::move(queue)}
+        , spill_{std::move(spill)}
+    {
+        budget_.queue_created();
+    }
+
+    ~BudgetedMailboxQueue()
+    {
+        while (pop()) {
+        }
+        budget_.queue_destroyed();
+    }
+
+    std::size_t bytes() const
+    {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+
+    virtual bool has_messages() const override
+    {
+        return queue_->has_messages() || spilled_.load(std::memory_order_acquire) > 0;
+    }
+
+    virtual MessageEnvelope pop() override
+    {
+        auto envelope = queue_->pop();
+        if (envelope) {
+            auto size = budget_.size_of(*envelope.message);
+            if (bytes_.fetch_sub(size, std::memory_order_relaxed) == size) {
+                budget_.queue_drained();
+            }
+            budget_.release(size);
+            return envelope;
+        }
+        while (spilled_.load(std::memory_order_acquire) > 0) {
+            envelope = spill_->pop();
+            auto lost = spill_->take_lost();
+            if (lost) {
+                spilled_.fetch_sub(lost, std::memory_order_release);
+                budget_.count_lost(lost);
+            }
+            if (envelope) {
+                spilled_.fetch_sub(1, std::memory_order_release);
+                return envelope;
+            }
+            if (!lost) {
+                // Counted by a pusher that has yet to write it.
+                break;
+            }
+        }
+        return MessageEnvelope{};
+    }
+
+    virtual bool push(MessageEnvelope envelope) override
+    {
+        auto size = budget_.size_of(*envelope.message);
+        if (spilled_.load(std::memory_order_acquire) == 0 && budget_.admit(bytes(), size)) {
+            budget_.charge(size);
+            if (bytes_.fetch_add(size, std::memory_order_relaxed) == 0) {
+                budget_.queue_activated();
+            }
+            return queue_->push(std::move(envelope));
+        }
+        if (!spill_) {
+            budget_.count_rejected();
+            return false;
+        }
+        spilled_.fetch_add(1, std::memory_order_acq_rel);
+        spill_->push(std::move(envelope));
+        budget_.count_spilled();
+        return true;
+    }
+
+private:
+    MemoryBudget &budget_;
+    std::unique_ptr<IMailboxQueue> queue_;
+    std::shared_ptr<ISpillStore> spill_;
+    std::atomic<std::size_t> bytes_{0};
+    std::atomic<std::size_t> spilled_{0};
+};
+
+// Mailboxes whose user messages are held to MemoryBudget::instance(). System
+// messages are never budgeted. Give every mailbox its own spill store, e.g.
+//
+//     props->with_mailbox([]() { return BudgetedMailbox::create(); });
+class BudgetedMailbox
+{
+public:
+    static std::shared_ptr<IMailbox> create(std::shared_ptr<ISpillStore> spill = nullptr)
+    {
+        auto user_messages = std::make_unique<BudgetedMailboxQueue>(std::make_unique<UnboundedMailboxQueue>(), std::move(spill));
+        return std::make_shared<DefaultMailbox>(std::make_unique<UnboundedMailboxQueue>(), std::move(user_messages));
+    }
+};
+
+} // namespace mailbox
+} // namespace protoactor
+
+#endif // PROTOACTOR_MEMORY_BUDGET_HPP
@@ -1,11 +1,17 @@
 #ifndef PROTOACTOR_PROTOACTOR_HPP
 #define PROTOACTOR_PROTOACTOR_HPP
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <protoactor/clock.hpp>
+#include <protoactor/communication_graph.hpp>
 #include <protoactor/mailbox.hpp>
+#include <protoactor/recycler.hpp>
 #include <protoactor/types.hpp>
 #include <memory>
 #include <mutex>
@@ -13,6 +19,9 @@
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace protoactor
 {
@@ -21,11 +30,14 @@ using namespace mailbox;
 
 class IContext;
 class PID;
+class Process;
 class Props;
 
 enum class ContextState
 {
     None,
+    // Spawned lazily; the actor is created by the first user message.
+    Dormant,
     Alive,
     Restarting,
     Stopping,
@@ -46,11 +58,220 @@ public:
     }
 };
 
+class StopMessage : public SystemMessage
+{
+public:
+    StopMessage()
+        : SystemMessage{true}
+    {
+    }
+
+    static Message::UPtr instance()
+    {
+        static StopMessage _instance;
+        return Message::UPtr{&_instance};
+    }
+};
+
+class StoppingMessage : public SystemMessage
+{
+public:
+    StoppingMessage()
+        : SystemMessage{true}
+    {
+    }
+
+    static Message::UPtr instance()
+    {
+        static StoppingMessage _instance;
+        return Message::UPtr{&_instance};
+    }
+};
+
+class StoppedMessage : public SystemMessage
+{
+public:
+    StoppedMessage()
+        : SystemMessage{true}
+    {
+    }
+
+    static Message::UPtr instance()
+    {
+        static StoppedMessage _instance;
+        return Message::UPtr{&_instance};
+    }
+};
+
+// Sent by a stopped child to its parent.
+class ChildTerminatedMessage : public SystemMessage
+{
+public:
+    explicit ChildTerminatedMessage(const std::string &id)
+        : id{id}
+    {
+    }
+
+    const std::string id;
+};
+
+class PID
+{
+public:
+    PID(const std::string &address, const std::string &id)
+        : address_(address)
+        , id_(id)
+    {
+    }
+
+    // Already resolved to `process`.
+    PID(const std::string &address, const std::string &id, std::shared_ptr<Process> process)
+        : address_(address)
+        , id_(id)
+        , process_(std::move(process))
+    {
+    }
+
+    const std::string &address() const { return address_; }
+    const std::string &id() const { return id_; }
+
+    void stop();
+
+    template <typename TMessage, typename... TArgs>
+    void tell(TArgs &&...args)
+    {
+        tell(Message::UPtr{new TMessage(std::forward<TArgs>(args)...)});
+    }
+
+    void tell(Message::UPtr message);
+    void tell(MessageEnvelope envelope);
+    // Moves `count` messages out of `envelopes` and enqueues them together.
+    void tell(MessageEnvelope *envelopes, std::size_t count);
+
+private:
+    Process *ref();
+
+    std::string address_;
+    std::string id_;
+    std::shared_ptr<Process> process_;
+};
+
+// An actor's children by id, with their processes, so that they are
+// resolved and stopped without going through the ProcessRegistry. The first
+// few are stored inline so that most actors need no allocation for them;
+// more spill into a hash map.
+class ChildSet
+{
+public:
+    bool empty() const { return size() == 0; }
+    std::size_t size() const { return spilled_ ? spilled_->size() : size_; }
+
+    // The process of the child `id`, or nullptr.
+    const std::shared_ptr<Process> *find(const std::string &id) const
+    {
+        if (spilled_) {
+            auto iter = spilled_->find(id);
+            return iter != spilled_->end() ? &iter->second : nullptr;
+        }
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (inline_[i].first == id) {
+                return &inline_[i].second;
+            }
+        }
+        return nullptr;
+    }
+
+    bool contains(const std::string &id) const
+    {
+        return find(id) != nullptr;
+    }
+
+    void insert(const std::string &id, std::shared_ptr<Process> process)
+    {
+        if (spilled_) {
+            spilled_->emplace(id, std::move(process));
+        } else if (size_ < inline_capacity) {
+            inline_[size_++] = Child{id, std::move(process)};
+        } else {
+            spilled_ = std::make_unique<std::unordered_map<std::string, std::shared_ptr<Process>>>(inline_.begin(), inline_.end());
+            spilled_->emplace(id, std::move(process));
+            clear_inline();
+        }
+    }
+
+    void erase(const std::string &id)
+    {
+        if (spilled_) {
+            spilled_->erase(id);
+            return;
+        }
+        auto end = inline_.begin() + size_;
+        auto iter = std::find_if(inline_.begin(), end, [&id](const Child &child) {
+            return child.first == id;
+        });
+        if (iter != end) {
+            std::swap(*iter, *(end - 1));
+            *(end - 1) = Child{};
+            --size_;
+        }
+    }
+
+    // Calls `function` with the id and process of every child.
+    template <typename TFunction>
+    void for_each(TFunction &&function) const
+    {
+        if (spilled_) {
+            for (auto &child : *spilled_) {
+                function(child.first, child.second);
+            }
+            return;
+        }
+        for (std::size_t i = 0; i < size_; ++i) {
+            function(inline_[i].first, inline_[i].second);
+        }
+    }
+
+    void clear()
+    {
+        spilled_.reset();
+        clear_inline();
+    }
+
+private:
+    using Child = std::pair<std::string, std::shared_ptr<Process>>;
+
+    static const std::size_t inline_capacity = 2;
+
+    void clear_inline()
+    {
+        for (std::size_t i = 0; i < size_; ++i) {
+            inline_[i] = Child{};
+        }
+        size_ = 0;
+    }
+
+    std::array<Child, inline_capacity> inline_;
+    std::size_t size_{0};
+    std::unique_ptr<std::unordered_map<std::string, std::shared_ptr<Process>>> spilled_;
+};
+
 class IActor
 {
 public:
     virtual ~IActor() = default;
-    virtual void receive(const IContext &context) = 0;
+
+    virtual void receive(const IContext &)
+    {
+    }
+
+    // Like receive(), but reports failure by returning it rather than by
+    // throwing, which is the only way to fail with PROTOACTOR_NO_EXCEPTIONS.
+    // Calls receive() unless overridden.
+    virtual Status try_receive(const IContext &context)
+    {
+        receive(context);
+        return Status{};
+    }
 };
 
 using Producer = std::function<std::unique_ptr<IActor> ()>;
@@ -64,32 +285,201 @@ public:
 
 class IContext : public ISenderContext
 {
+public:
+    // The child of this actor spawned with `name`, or nullptr. Looked up in
+    // this actor's own children, so only from its own thread.
+    virtual std::unique_ptr<PID> child(const std::string &name) const = 0;
+    virtual const MessageHeader &header() const = 0;
+    virtual const PID &self() const = 0;
+
+    // The PID of the actor that sent the current message with request(), or
+    // nullptr. Valid while the message is processed, even if the sender has
+    // stopped since.
+    virtual const PID *sender() const = 0;
+
+    // Tells `target` with this actor as the sender. The trace id and deadline
+    // of the message being processed are carried over.
+    virtual void request(PID &target, Message::UPtr message) const = 0;
+
+    template <typename TMessage, typename... TArgs>
+    void request(PID &target, TArgs &&...args) const
+    {
+        request(target, Message::UPtr{new TMessage(std::forward<TArgs>(args)...)});
+    }
+
+    // Replies to sender(), as a request, straight into the process the
+    // sender holds: no registry lookup, no cast, only a virtual liveness
+    // check. The message is dropped when there is no sender, and goes to dead
+    // letters when the sender has stopped. Replies are not sampled into the
+    // CommunicationGraph, as the request they answer already was.
+    virtual void respond(Message::UPtr message) const = 0;
+
+    template <typename TMessage, typename... TArgs>
+    void respond(TArgs &&...args) const
+    {
+        respond(Message::UPtr{new TMessage(std::forward<TArgs>(args)...)});
+    }
+
+    // Spawns a child named "<self id>/<name>". Children are stopped with
+    // their parent. A child's id is its path from the root actor, so from
+    // outside the tree PID(address, "a/b/c") reaches it like any other.
+    virtual std::unique_ptr<PID> spawn(const Props &props) const = 0;
+    virtual std::unique_ptr<PID> spawn_named(const Props &props, const std::string &name) const = 0;
+};
+
+// The Sender a LocalContext puts on what its actor sends.
+class LocalSender : public Sender
+{
+public:
+    // Copies only the address and id of `pid`; the process is held here
+    // instead, like a PID holds the process it resolved, so that replies go
+    // straight to it.
+    LocalSender(const PID &pid, std::shared_ptr<Process> process)
+        : pid_{pid.address(), pid.id()}
+        , process_{std::move(process)}
+    {
+    }
+
+    virtual const PID &pid() const override
+    {
+        return pid_;
+    }
+
+    virtual Process *process() const override
+    {
+        return process_.get();
+    }
+
+    // Only while nothing else refers to this sender.
+    void reuse(const PID &pid, std::shared_ptr<Process> process)
+    {
+        pid_ = PID{pid.address(), pid.id()};
+        process_ = std::move(process);
+        renew_id();
+    }
+
+    void clear()
+    {
+        process_.reset();
+    }
+
+private:
+    PID pid_;
+    std::shared_ptr<Process> process_;
 };
 
 class LocalContext : public IMessageInvoker, public IContext
 {
 public:
-    LocalContext(const Producer &producer, PID *parent)
-        : parent_{parent}
+    LocalContext(const Producer &producer, PID *parent, const PID &self, const std::shared_ptr<Process> &process = nullptr, bool lazy = false)
+        : process_{process}
         , producer_{producer}
+        , self_{self}
+    {
+        attach_parent(parent);
+        lazy ? defer_incarnation() : incarnate_actor();
+    }
+
+    // Like std::make_shared<LocalContext>, but reuses a context released by a
+    // stopped actor when one is available.
+    static std::shared_ptr<LocalContext> acquire(const Producer &producer, PID *parent, const PID &self, const std::shared_ptr<Process> &process = nullptr, bool lazy = false)
+    {
+        auto context = Recycler<LocalContext>::instance().pop();
+        if (context) {
+            context->attach_parent(parent);
+            context->process_ = process;
+            context->producer_ = producer;
+            context->self_ = self;
+            lazy ? context->defer_incarnation() : context->incarnate_actor();
+        } else {
+            context = new LocalContext(producer, parent, self, process, lazy);
+        }
+        context->last_activity_.store(RuntimeClock::instance().coarse_now(), std::memory_order_relaxed);
+        return std::shared_ptr<LocalContext>(context, [](LocalContext *released) {
+            released->actor_.reset();
+            released->children_.clear();
+            released->message_.reset();
+            released->parent_.reset();
+            released->process_.reset();
+            released->release_sender();
+            released->producer_ = nullptr;
+            released->state_ = ContextState::None;
+            if (!Recycler<LocalContext>::instance().push(released)) {
+                delete released;
+            }
+        });
+    }
+
+    // The context whose actor is processing a message on the calling thread.
+    static LocalContext *current()
+    {
+        return current_ref();
+    }
+
+    // The Sender::id() that request() and respond() put on this actor's
+    // messages, for telling its plain tells apart the same way. Only from
+    // the actor's own thread, like current().
+    std::uint64_t sender_id() const
     {
-        incarnate_actor();
+        return outgoing_sender()->id();
     }
 
-    virtual void escalate_failure(const std::exception &, const Message::SPtr &) override
+    // When this context was acquired or last processed a message, in
+    // RuntimeClock::coarse_now() time. May be read from any thread.
+    std::int64_t last_activity() const
     {
+        return last_activity_.load(std::memory_order_relaxed);
     }
 
-    virtual void invoke_system_message(const Message::SPtr &message) override
+    // May be read from any thread.
+    ContextState state() const
+    {
+        return state_;
+    }
+
+    virtual void escalate_failure(const Status &, const Message::SPtr &) override
+    {
+    }
+
+    virtual Status invoke_system_message(const Message::SPtr &message) override
     {
         if (dynamic_cast<StartedMessage *>(message.get())) {
-            return invoke_user_message(message);
+            return invoke_user_message(message, MessageHeader{});
         }
+        if (dynamic_cast<StopMessage *>(message.get())) {
+            handle_stop();
+        } else if (auto terminated = dynamic_cast<ChildTerminatedMessage *>(message.get())) {
+            children_.erase(terminated->id);
+        }
+        return Status{};
     }
 
-    virtual void invoke_user_message(const Message::SPtr &message) override
+    virtual Status invoke_user_message(const Message::SPtr &message, const MessageHeader &header) override
     {
-        process_message(message);
+        if (state_ == ContextState::Dormant) {
+            incarnate_actor();
+            auto started = process_message(Message::SPtr{StartedMessage::instance()}, MessageHeader{});
+            if (!started) {
+                return started;
+            }
+        }
+        // Messages still queued behind a stop go nowhere, like dead letters.
+        if (!actor_) {
+            return Status{};
+        }
+        return process_message(message, header);
+    }
+
+    virtual std::unique_ptr<PID> child(const std::string &name) const override;
+
+    const ChildSet &children() const
+    {
+        return children_;
+    }
+
+    virtual const MessageHeader &header() const override
+    {
+        return header_;
     }
 
     virtual Message::SPtr message() const override
@@ -97,11 +487,46 @@ public:
         return message_;
     }
 
+    virtual void request(PID &target, Message::UPtr message) const override
+    {
+        target.tell(MessageEnvelope{std::move(message), outgoing_header()});
+    }
+
+    virtual void respond(Message::UPtr message) const override;
+
+    virtual const PID &self() const override
+    {
+        return self_;
+    }
+
+    virtual const PID *sender() const override
+    {
+        return header_.sender ? &header_.sender->pid() : nullptr;
+    }
+
+    virtual std::unique_ptr<PID> spawn(const Props &props) const override;
+    virtual std::unique_ptr<PID> spawn_named(const Props &props, const std::string &name) const override;
+
 private:
-    static void default_receive(IContext &context)
+    static LocalContext *&current_ref()
+    {
+        static thread_local LocalContext *_current{nullptr};
+        return _current;
+    }
+
+    static Status default_receive(IContext &context)
     {
         auto &lc = static_cast<LocalContext &>(context);
-        return lc.actor_->receive(context);
+        return lc.actor_->try_receive(context);
+    }
+
+    void attach_parent(PID *parent);
+    void handle_stop();
+    void notify_parent();
+
+    void defer_incarnation()
+    {
+        state_ = ContextState::Dormant;
     }
 
     void incarnate_actor()
@@ -110,33 +535,85 @@ private:
         actor_ = producer_();
     }
 
-    void process_message(const Message::SPtr &message)
+    MessageHeader outgoing_header() const
     {
-        message_ = message;
-        default_receive(*this);
-        message_.reset();
+        return MessageHeader{outgoing_sender(), header_.trace_id, header_.deadline};
     }
 
-    std::unique_ptr<IActor> actor_;
-    Message::SPtr message_;
-    PID *parent_;
-    Producer producer_;
-    ContextState state_{ContextState::None};
-};
+    const SenderRef &outgoing_sender() const
+    {
+        if (!sender_current_) {
+            if (sender_.unique()) {
+                static_cast<LocalSender &>(*sender_).reuse(self_, process_.lock());
+            } else {
+                sender_ = SenderRef{new LocalSender(self_, process_.lock())};
+            }
+            sender_current_ = true;
+        }
+        return sender_;
+    }
 
-class StopMessage : public SystemMessage
-{
-public:
-    StopMessage()
-        : SystemMessage{true}
+    // The sender holds this actor's process, which holds the mailbox and
+    // through it this context, so it lets go once the actor has stopped. An
+    // unshared sender is kept for the next actor.
+    void release_sender()
     {
+        sender_current_ = false;
+        if (sender_.unique()) {
+            static_cast<LocalSender &>(*sender_).clear();
+        } else {
+            sender_.reset();
+        }
     }
 
-    static Message::UPtr instance()
+    Status process_message(const Message::SPtr &message, const MessageHeader &header)
     {
-        static StopMessage _instance;
-        return Message::UPtr{&_instance};
+        // Undone on the way out even if the actor throws, as the mailbox
+        // carries on with the next message.
+        class Scope
+        {
+        public:
+            Scope(LocalContext &context, const Message::SPtr &message, const MessageHeader &header)
+                : context_(context)
+                , previous_{current_ref()}
+            {
+                current_ref() = &context;
+                context.message_ = message;
+                context.header_ = header;
+            }
+
+            ~Scope()
+            {
+                context_.message_.reset();
+                context_.header_ = MessageHeader{};
+                current_ref() = previous_;
+            }
+
+        private:
+            LocalContext &context_;
+            LocalContext *previous_;
+        };
+
+        last_activity_.store(RuntimeClock::instance().coarse_now(), std::memory_order_relaxed);
+        Scope scope{*this, message, header};
+        return default_receive(*this);
     }
+
+    std::unique_ptr<IActor> actor_;
+    // Only touched by the actor's own mailbox run, like the rest.
+    mutable ChildSet children_;
+    MessageHeader header_;
+    Message::SPtr message_;
+    // Keeps the parent's mailbox and context around for ChildTerminatedMessage.
+    std::shared_ptr<Process> parent_;
+    std::weak_ptr<Process> process_;
+    // Made on the first request(); released when the actor stops.
+    mutable SenderRef sender_;
+    mutable bool sender_current_{false};
+    Producer producer_;
+    PID self_;
+    std::atomic<ContextState> state_{ContextState::None};
+    std::atomic<std::int64_t> last_activity_{0};
 };
 
 class Process
@@ -144,13 +621,27 @@ class Process
 public:
     virtual ~Process() = default;
 
+    // False once stopped, for processes that can tell.
+    virtual bool is_alive() const
+    {
+        return true;
+    }
+
     virtual void stop(PID *pid)
     {
         send_system_message(pid, StopMessage::instance());
     }
 
     virtual void send_system_message(PID *pid, Message::UPtr message) = 0;
-    virtual void send_user_message(PID *pid, Message::UPtr message) = 0;
+    virtual void send_user_message(PID *pid, MessageEnvelope envelope) = 0;
+
+    // Moves `count` messages out of `envelopes`, in order.
+    virtual void send_user_messages(PID *pid, MessageEnvelope *envelopes, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            send_user_message(pid, std::move(envelopes[i]));
+        }
+    }
 };
 
 class DeadLetterProcess : public Process
@@ -166,7 +657,7 @@ public:
     {
     }
 
-    virtual void send_user_message(PID *, Message::UPtr) override
+    virtual void send_user_message(PID *, MessageEnvelope) override
     {
     }
 };
@@ -179,54 +670,44 @@ public:
     {
     }
 
+    // Set by the spawner after the process is registered, so nullptr until
+    // then; stays valid for as long as the process is. May be read from any
+    // thread.
+    LocalContext *context() const { return context_.load(std::memory_order_acquire); }
     bool is_dead() const { return is_dead_; }
+    const std::shared_ptr<IMailbox> &mailbox() const { return mailbox_; }
+    void set_context(LocalContext *context) { context_.store(context, std::memory_order_release); }
 
     virtual void send_system_message(PID *, Message::UPtr message) override
     {
         mailbox_->post_system_message(std::move(message));
     }
 
-    virtual void send_user_message(PID *, Message::UPtr message) override
+    virtual void send_user_message(PID *, MessageEnvelope envelope) override
     {
-        mailbox_->post_user_message(std::move(message));
+        mailbox_->post_user_message(std::move(envelope));
     }
 
-    virtual void stop(PID *pid) override
+    virtual void send_user_messages(PID *, MessageEnvelope *envelopes, std::size_t count) override
     {
-        Process::stop(pid);
-        is_dead_.store(true);
+        mailbox_->post_user_messages(envelopes, count);
     }
 
-private:
-    std::shared_ptr<IMailbox> mailbox_;
-    std::atomic_bool is_dead_{false};
-};
-
-class PID
-{
-public:
-    PID(const std::string &address, const std::string &id)
-        : address_(address)
-        , id_(id)
+    virtual bool is_alive() const override
     {
+        return !is_dead_;
     }
 
-    const std::string &address() const { return address_; }
-    const std::string &id() const { return id_; }
-
-    template <typename TMessage, typename... TArgs>
-    void tell(TArgs &&...args)
+    virtual void stop(PID *pid) override
     {
-        tell(Message::UPtr{new TMessage(std::forward<TArgs>(args)...)});
+        is_dead_.store(true);
+        Process::stop(pid);
     }
 
 private:
-    Process *ref();
-    void tell(Message::UPtr message);
-
-    std::string address_;
-    std::string id_;
-    Process *process_{nullptr};
+    std::atomic<LocalContext *> context_{nullptr};
+    std::shared_ptr<IMailbox> mailbox_;
+    std::atomic_bool is_dead_{false};
 };
 
 class ProcessNameExistException : public std::invalid_argument
@@ -238,10 +719,17 @@ public:
     }
 };
 
+enum class RegistryError
+{
+    None,
+    NameExists,
+};
+
 class ProcessRegistry
 {
 public:
-    Process &get(const PID &pid) const;
+    // Held by the caller, as the process may be removed right after.
+    std::shared_ptr<Process> find(const std::string &id) const;
 
     static ProcessRegistry &instance()
     {
@@ -255,43 +743,117 @@ public:
         return '$' + std::to_string(id);
     }
 
-    std::unique_ptr<PID> try_add(const std::string &id, std::unique_ptr<Process> process);
+    void remove(const PID &pid);
+    RegistryError add(const std::string &id, std::shared_ptr<Process> process);
+    // Throws ProcessNameExistException when `id` is taken, or returns nullptr
+    // with PROTOACTOR_NO_EXCEPTIONS.
+    std::unique_ptr<PID> try_add(const std::string &id, std::shared_ptr<Process> process);
+
+    using Entries = std::vector<std::pair<std::string, std::shared_ptr<Process>>>;
+
+    std::size_t shards() const { return shard_count; }
+
+    // Appends the processes of one shard to `entries`, holding only that
+    // shard's lock, so that walking all shards never stops every sender.
+    void copy_shard(std::size_t index, Entries &entries) const
+    {
+        auto &s = shards_[index];
+        std::unique_lock<std::mutex> lock(s.mutex);
+        entries.insert(entries.end(), s.local_actor_refs.begin(), s.local_actor_refs.end());
+    }
 
 private:
-    using LocalActorRefs = std::unordered_map<std::string, std::unique_ptr<Process>>;
+    using LocalActorRefs = std::unordered_map<std::string, std::shared_ptr<Process>>;
+
+    // Processes are spread over independently locked shards by id, so that
+    // spawning and stopping actors does not serialize on a single mutex.
+    class Shard
+    {
+    public:
+        LocalActorRefs local_actor_refs;
+        mutable std::mutex mutex;
+    };
+
+    static const std::size_t shard_count = 64;
 
     static const char *no_host() { return "nonhost"; }
 
+    Shard &shard(const std::string &id) const
+    {
+        return shards_[std::hash<std::string>()(id) % shard_count];
+    }
+
     std::string address_{no_host()};
-    LocalActorRefs local_actor_refs_;
-    mutable std::mutex mutex_;
+    mutable std::array<Shard, shard_count> shards_;
     std::atomic_int sequence_id_{0};
 };
 
-using MailboxProducer = std::function<std::unique_ptr<IMailbox> ()>;
-using Spawner = std::function<std::unique_ptr<PID> (const std::string &id, const Props &props, PID *parent)>;
+using MailboxProducer = std::function<std::shared_ptr<IMailbox> ()>;
+// `initial_messages` points at `initial_count` user messages to enqueue before
+// the actor's mailbox starts.
+using Spawner = std::function<std::unique_ptr<PID> (const std::string &id, const Props &props, PID *parent, MessageEnvelope *initial_messages, std::size_t initial_count)>;
 
 class Props
 {
 public:
-    static std::unique_ptr<PID> default_spawner(const std::string &name, const Props &props, PID *parent)
+    static std::unique_ptr<PID> default_spawner(const std::string &name, const Props &props, PID *parent, MessageEnvelope *initial_messages, std::size_t initial_count)
     {
-        std::shared_ptr<IMailbox> mailbox = props.mailbox_producer_();
-        auto pid = ProcessRegistry::instance().try_add(name, std::make_unique<LocalProcess>(mailbox));
-        auto ctx = std::make_shared<LocalContext>(props.producer(), parent);
+        auto mailbox = props.mailbox_producer_();
+        auto process = std::make_shared<LocalProcess>(mailbox);
+        auto pid = ProcessRegistry::instance().try_add(name, process);
+        if (!pid) {
+            return nullptr;
+        }
+        auto ctx = LocalContext::acquire(props.producer(), parent, *pid, process, props.lazy_incarnation());
+        process->set_context(ctx.get());
         auto &dispatcher = props.dispatcher();
         mailbox->register_handlers(ctx, dispatcher);
-        mailbox->post_system_message(StartedMessage::instance());
+        mailbox->set_priority(props.priority());
+        if (!props.lazy_incarnation()) {
+            mailbox->post_system_message(StartedMessage::instance());
+        }
+        mailbox->post_user_messages(initial_messages, initial_count);
         mailbox->start();
         return pid;
     }
 
     IDispatcher &dispatcher() const { return *dispatcher_; }
+    bool lazy_incarnation() const { return lazy_incarnation_; }
+    SchedulePriority priority() const { return priority_; }
     const Producer &producer() const { return producer_; }
 
-    std::unique_ptr<PID> spawn(const std::string &name, PID *parent) const
+    std::unique_ptr<PID> spawn(const std::string &name, PID *parent, MessageEnvelope *initial_messages = nullptr, std::size_t initial_count = 0) const
+    {
+        return spawner_(name, *this, parent, initial_messages, initial_count);
+    }
+
+    Props &with_dispatcher(IDispatcher &dispatcher)
+    {
+        dispatcher_ = &dispatcher;
+        return *this;
+    }
+
+    // Defers creating the actor until its first user message, which is
+    // preceded by StartedMessage. An actor stopped before that never exists
+    // and gets neither StoppingMessage nor StoppedMessage.
+    Props &with_lazy_incarnation(bool lazy = true)
+    {
+        lazy_incarnation_ = lazy;
+        return *this;
+    }
+
+    Props &with_mailbox(MailboxProducer &&mailbox_producer)
+    {
+        mailbox_producer_ = std::move(mailbox_producer);
+        return *this;
+    }
+
+    // The priority the actor's mailbox is scheduled with, for dispatchers
+    // that support it; the priority of messages within it is unaffected.
+    Props &with_priority(SchedulePriority priority)
     {
-        return spawner_(name, *this, parent);
+        priority_ = priority;
+        return *this;
     }
 
     Props &with_producer(Producer &&producer)
@@ -301,12 +863,14 @@ public:
     }
 
 private:
-    static std::unique_ptr<IMailbox> produce_default_mailbox()
+    static std::shared_ptr<IMailbox> produce_default_mailbox()
     {
-        return UnboundedMailbox::create();
+        return UnboundedMailbox::acquire();
     }
 
     IDispatcher *dispatcher_{&Dispatchers::default_dispatcher()};
+    bool lazy_incarnation_{false};
+    SchedulePriority priority_{SchedulePriority::Normal};
     MailboxProducer mailbox_producer_{&Props::produce_default_mailbox};
     Producer producer_;
     Spawner spawner_{&Props::default_spawner};
@@ -328,54 +892,202 @@ public:
         return spawn_named(props, name);
     }
 
+    // Spawns with `messages` already queued behind StartedMessage, so that
+    // starting and handling them takes a single run of the mailbox.
+    template <typename... TMessages>
+    static std::unique_ptr<PID> spawn(const Props &props, Message::UPtr message, TMessages &&...messages)
+    {
+        auto name = ProcessRegistry::instance().next_id();
+        return spawn_named(props, name, std::move(message), std::forward<TMessages>(messages)...);
+    }
+
     static std::unique_ptr<PID> spawn_named(const Props &props, const std::string &name)
     {
         return props.spawn(name, nullptr);
     }
+
+    template <typename... TMessages>
+    static std::unique_ptr<PID> spawn_named(const Props &props, const std::string &name, Message::UPtr message, TMessages &&...messages)
+    {
+        MessageEnvelope initial[] = {MessageEnvelope{std::move(message)}, MessageEnvelope{std::forward<TMessages>(messages)}...};
+        return props.spawn(name, nullptr, initial, 1 + sizeof...(TMessages));
+    }
 };
 
+void LocalContext::handle_stop()
+{
+    if (state_ == ContextState::Stopping || state_ == ContextState::None) {
+        return;
+    }
+    if (state_ == ContextState::Dormant) {
+        ProcessRegistry::instance().remove(self_);
+        state_ = ContextState::None;
+        notify_parent();
+        release_sender();
+        return;
+    }
+    state_ = ContextState::Stopping;
+    // Each child stops its own children in turn, so this only ever visits
+    // the subtree.
+    children_.for_each([](const std::string &, const std::shared_ptr<Process> &child) {
+        child->stop(nullptr);
+    });
+    children_.clear();
+    auto &registry = ProcessRegistry::instance();
+    invoke_user_message(Message::SPtr{StoppingMessage::instance()}, MessageHeader{});
+    registry.remove(self_);
+    invoke_user_message(Message::SPtr{StoppedMessage::instance()}, MessageHeader{});
+    actor_.reset();
+    state_ = ContextState::None;
+    notify_parent();
+    release_sender();
+}
+
+void LocalContext::attach_parent(PID *parent)
+{
+    parent_ = parent ? ProcessRegistry::instance().find(parent->id()) : nullptr;
+}
+
+void LocalContext::notify_parent()
+{
+    if (parent_) {
+        parent_->send_system_message(nullptr, Message::UPtr{new ChildTerminatedMessage(self_.id())});
+        parent_.reset();
+    }
+}
+
+std::unique_ptr<PID> LocalContext::child(const std::string &name) const
+{
+    auto id = self_.id() + '/' + name;
+    auto process = children_.find(id);
+    if (!process) {
+        return nullptr;
+    }
+    return std::make_unique<PID>(self_.address(), id, *process);
+}
+
+std::unique_ptr<PID> LocalContext::spawn(const Props &props) const
+{
+    return spawn_named(props, ProcessRegistry::instance().next_id());
+}
+
+std::unique_ptr<PID> LocalContext::spawn_named(const Props &props, const std::string &name) const
+{
+    auto id = self_.id() + '/' + name;
+    auto pid = props.spawn(id, const_cast<PID *>(&self_));
+    if (pid) {
+        if (auto process = ProcessRegistry::instance().find(id)) {
+            children_.insert(id, std::move(process));
+        }
+    }
+    return pid;
+}
+
+void LocalContext::respond(Message::UPtr message) const
+{
+    if (!header_.sender) {
+        return;
+    }
+    auto process = header_.sender->process();
+    auto &target = process && process->is_alive() ? *process : DeadLetterProcess::instance();
+    target.send_user_message(const_cast<PID *>(&header_.sender->pid()), MessageEnvelope{std::move(message), outgoing_header()});
+}
+
 Process *PID::ref()
 {
     if (process_) {
-        auto lp = dynamic_cast<LocalProcess *>(process_);
+        auto lp = dynamic_cast<LocalProcess *>(process_.get());
         if (lp && lp->is_dead()) {
-            process_ = nullptr;
+            process_.reset();
         }
-        return process_;
+        return process_.get();
     }
-    auto reff = &ProcessRegistry::instance().get(*this);
-    if (!dynamic_cast<DeadLetterProcess *>(reff)) {
-        process_ = reff;
+    process_ = ProcessRegistry::instance().find(id_);
+    return process_.get();
+}
+
+void PID::stop()
+{
+    auto p = ref();
+    if (p) {
+        p->stop(this);
     }
-    return process_;
 }
 
 void PID::tell(Message::UPtr message)
 {
+    tell(MessageEnvelope{std::move(message)});
+}
+
+void PID::tell(MessageEnvelope envelope)
+{
+    auto &graph = CommunicationGraph::instance();
+    if (graph.should_sample()) {
+        if (auto sender = LocalContext::current()) {
+            graph.record(sender->self().id(), id_);
+        }
+    }
     auto p = ref();
-    auto &reff = p ? *p : ProcessRegistry::instance().get(*this);
-    reff.send_user_message(this, std::move(message));
+    auto &reff = p ? *p : DeadLetterProcess::instance();
+    reff.send_user_message(this, std::move(envelope));
+}
+
+void PID::tell(MessageEnvelope *envelopes, std::size_t count)
+{
+    auto &graph = CommunicationGraph::instance();
+    if (graph.should_sample()) {
+        if (auto sender = LocalContext::current()) {
+            graph.record(sender->self().id(), id_);
+        }
+    }
+    auto p = ref();
+    auto &reff = p ? *p : DeadLetterProcess::instance();
+    reff.send_user_messages(this, envelopes, count);
+}
+
+std::shared_ptr<Process> ProcessRegistry::find(const std::string &id) const
+{
+    auto &s = shard(id);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    auto iter = s.local_actor_refs.find(id);
+    if (s.local_actor_refs.end() == iter) {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+void ProcessRegistry::remove(const PID &pid)
+{
+    auto &s = shard(pid.id());
+    // Declared before the lock so that the process is released outside it.
+    std::shared_ptr<Process> removed;
+    std::unique_lock<std::mutex> lock(s.mutex);
+    auto iter = s.local_actor_refs.find(pid.id());
+    if (s.local_actor_refs.end() != iter) {
+        removed = std::move(iter->second);
+        s.local_actor_refs.erase(iter);
+    }
 }
 
-Process &ProcessRegistry::get(const PID &pid) const
+RegistryError ProcessRegistry::add(const std::string &id, std::shared_ptr<Process> process)
 {
-    std::unique_lock<std::mutex> lock(mutex_);
-    auto iter = local_actor_refs_.find(pid.id());
-    if (local_actor_refs_.end() == iter) {
-        return DeadLetterProcess::instance();
+    auto &s = shard(id);
+    std::unique_lock<std::mutex> lock(s.mutex);
+    if (!s.local_actor_refs.emplace(id, std::move(process)).second) {
+        return RegistryError::NameExists;
     }
-    return *iter->second.get();
+    return RegistryError::None;
 }
 
-std::unique_ptr<PID> ProcessRegistry::try_add(const std::string &id, std::unique_ptr<Process> process)
+std::unique_ptr<PID> ProcessRegistry::try_add(const std::string &id, std::shared_ptr<Process> process)
 {
     auto pid = std::make_unique<PID>(address_, id);
-    auto emplace_result = [&]() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        return local_actor_refs_.emplace(id, std::move(process));
-    }();
-    if (!emplace_result.second) {
+    if (add(id, std::move(process)) != RegistryError::None) {
+#ifdef PROTOACTOR_NO_EXCEPTIONS
+        return nullptr;
+#else
         throw ProcessNameExistException(id);
+#endif
     }
     return pid;
 }
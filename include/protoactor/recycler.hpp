@@ -0,0 +1,43 @@
+#ifndef PROTOACTOR_RECYCLER_HPP
+#define PROTOACTOR_RECYCLER_HPP
+
+#include <boost/lockfree/stack.hpp>
+#include <cstddef>
+
+namespace protoactor
+{
+
+// Bounded lock-free free list of T instances. Objects that do not fit are
+// left to the caller to delete. The instance is never destroyed so that
+// objects released during static destruction still find it.
+template <typename T, std::size_t Capacity = 4096>
+class Recycler
+{
+public:
+    static Recycler &instance()
+    {
+        static auto _instance = new Recycler;
+        return *_instance;
+    }
+
+    T *pop()
+    {
+        T *object{nullptr};
+        free_.pop(object);
+        return object;
+    }
+
+    bool push(T *object)
+    {
+        return free_.bounded_push(object);
+    }
+
+private:
+    Recycler() = default;
+
+    boost::lockfree::stack<T *, boost::lockfree::capacity<Capacity>> free_;
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_RECYCLER_HPP
@@ -0,0 +1,201 @@
+#ifndef PROTOACTOR_ROUTER_HPP
+#define PROTOACTOR_ROUTER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <protoactor/protoactor.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PROTOACTOR_HAS_AVX2_TARGET 1
+#endif
+
+namespace protoactor
+{
+
+// Routes messages by a 64-bit key over a ring of virtual nodes, so that a
+// key keeps going to the same routee and adding or removing a routee moves
+// only about 1/N of the keys.
+//
+// tell(keys, messages, count) is meant for large batches: the keys are hashed
+// eight at a time with AVX2 when the CPU has it, ring positions are found
+// with a branchless binary search, and the messages are bucketed per routee
+// so that each routee gets a single enqueue and the routees' mailboxes are
+// scheduled as one batch. The scratch space for that is kept between calls,
+// so a router must not be used by several threads at once. There must be at
+// least one routee.
+class ConsistentHashRouter
+{
+public:
+    ConsistentHashRouter(const std::vector<PID> &routees, std::size_t replicas = 100)
+        : routees_(routees)
+    {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> ring;
+        ring.reserve(routees_.size() * replicas);
+        for (std::size_t routee = 0; routee < routees_.size(); ++routee) {
+            for (std::size_t replica = 0; replica < replicas; ++replica) {
+                ring.emplace_back(hash(routees_[routee].id() + '#' + std::to_string(replica)), static_cast<std::uint32_t>(routee));
+            }
+        }
+        std::sort(ring.begin(), ring.end());
+        positions_.reserve(ring.size());
+        owners_.reserve(ring.size());
+        for (auto &node : ring) {
+            positions_.push_back(node.first);
+            owners_.push_back(node.second);
+        }
+    }
+
+    static std::uint32_t hash(std::uint64_t key)
+    {
+        auto x = static_cast<std::uint32_t>(key) ^ (static_cast<std::uint32_t>(key >> 32) * 0x9e3779b1u);
+        x ^= x >> 16;
+        x *= 0x85ebca6bu;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35u;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // FNV-1a, finished like the integer hash; stable across platforms, unlike
+    // std::hash.
+    static std::uint32_t hash(const std::string &key)
+    {
+        std::uint32_t x = 0x811c9dc5u;
+        for (auto c : key) {
+            x = (x ^ static_cast<unsigned char>(c)) * 0x01000193u;
+        }
+        return hash(static_cast<std::uint64_t>(x));
+    }
+
+    // Same results as hash(key) for each key.
+    static void hash_keys(const std::uint64_t *keys, std::uint32_t *hashes, std::size_t count)
+    {
+#ifdef PROTOACTOR_HAS_AVX2_TARGET
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        if (avx2) {
+            return hash_keys_avx2(keys, hashes, count);
+        }
+#endif
+        hash_keys_scalar(keys, hashes, count);
+    }
+
+    static void hash_keys_scalar(const std::uint64_t *keys, std::uint32_t *hashes, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            hashes[i] = hash(keys[i]);
+        }
+    }
+
+    std::size_t routee_count() const
+    {
+        return routees_.size();
+    }
+
+    // The routee owning the first ring position at or after `hash`, wrapping
+    // around. The search has a fixed number of steps and compiles to
+    // conditional moves.
+    std::size_t routee_index(std::uint32_t hash) const
+    {
+        const auto *base = positions_.data();
+        auto n = positions_.size();
+        while (n > 1) {
+            auto half = n / 2;
+            base = base[half] < hash ? base + half : base;
+            n -= half;
+        }
+        auto index = static_cast<std::size_t>(base - positions_.data()) + (*base < hash);
+        return owners_[index == positions_.size() ? 0 : index];
+    }
+
+    PID &route(std::uint64_t key)
+    {
+        return routees_[routee_index(hash(key))];
+    }
+
+    void tell(std::uint64_t key, Message::UPtr message)
+    {
+        route(key).tell(std::move(message));
+    }
+
+    // Moves the `count` messages out of `messages`; messages for the same
+    // routee keep their relative order.
+    void tell(const std::uint64_t *keys, Message::UPtr *messages, std::size_t count)
+    {
+        if (routees_.empty()) {
+            return;
+        }
+        hashes_.resize(count);
+        owner_of_.resize(count);
+        hash_keys(keys, hashes_.data(), count);
+        offsets_.assign(routees_.size() + 1, 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto routee = static_cast<std::uint32_t>(routee_index(hashes_[i]));
+            owner_of_[i] = routee;
+            ++offsets_[routee + 1];
+        }
+        for (std::size_t routee = 0; routee < routees_.size(); ++routee) {
+            offsets_[routee + 1] += offsets_[routee];
+        }
+        bucketed_.resize(count);
+        cursors_.assign(offsets_.begin(), offsets_.end() - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            bucketed_[cursors_[owner_of_[i]]++].message = std::move(messages[i]);
+        }
+        ScheduleBatch batch;
+        for (std::size_t routee = 0; routee < routees_.size(); ++routee) {
+            auto begin = offsets_[routee];
+            auto end = offsets_[routee + 1];
+            if (begin != end) {
+                routees_[routee].tell(bucketed_.data() + begin, end - begin);
+            }
+        }
+    }
+
+private:
+#ifdef PROTOACTOR_HAS_AVX2_TARGET
+    __attribute__((target("avx2")))
+    static void hash_keys_avx2(const std::uint64_t *keys, std::uint32_t *hashes, std::size_t count)
+    {
+        const auto golden = _mm256_set1_epi32(static_cast<int>(0x9e3779b1u));
+        const auto c1 = _mm256_set1_epi32(static_cast<int>(0x85ebca6bu));
+        const auto c2 = _mm256_set1_epi32(static_cast<int>(0xc2b2ae35u));
+        // Low halves of four keys to the lower 128 bits, high halves above.
+        const auto split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            auto a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)), split);
+            auto b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i + 4)), split);
+            auto lo = _mm256_permute2x128_si256(a, b, 0x20);
+            auto hi = _mm256_permute2x128_si256(a, b, 0x31);
+            auto x = _mm256_xor_si256(lo, _mm256_mullo_epi32(hi, golden));
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            x = _mm256_mullo_epi32(x, c1);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 13));
+            x = _mm256_mullo_epi32(x, c2);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(hashes + i), x);
+        }
+        hash_keys_scalar(keys + i, hashes + i, count - i);
+    }
+#endif
+
+    std::vector<PID> routees_;
+    // The ring, sorted by position.
+    std::vector<std::uint32_t> positions_;
+    std::vector<std::uint32_t> owners_;
+    // Scratch space for batches.
+    std::vector<std::uint32_t> hashes_;
+    std::vector<std::uint32_t> owner_of_;
+    std::vector<std::size_t> offsets_;
+    std::vector<std::size_t> cursors_;
+    std::vector<MessageEnvelope> bucketed_;
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_ROUTER_HPP
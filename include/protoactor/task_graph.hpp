@@ -0,0 +1,155 @@
+#ifndef PROTOACTOR_TASK_GRAPH_HPP
+#define PROTOACTOR_TASK_GRAPH_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <protoactor/mailbox.hpp>
+#include <vector>
+
+namespace protoactor
+{
+
+// A DAG of lightweight tasks executed on a dispatcher. Every task counts its
+// unfinished predecessors atomically; the one finishing the last predecessor
+// schedules it directly on the dispatcher (on a ThreadPoolDispatcher worker
+// that is the worker's own stealable queue), so no mailbox is involved.
+class TaskGraph
+{
+public:
+    using Task = std::function<void ()>;
+    using TaskId = std::size_t;
+
+    TaskId add(Task &&task)
+    {
+        nodes_.push_back(std::make_unique<Node>());
+        nodes_.back()->task = std::move(task);
+        return nodes_.size() - 1;
+    }
+
+    // `after` runs only once `before` has finished.
+    void precede(TaskId before, TaskId after)
+    {
+        nodes_[before]->successors.push_back(after);
+        ++nodes_[after]->predecessors;
+    }
+
+    std::size_t size() const
+    {
+        return nodes_.size();
+    }
+
+    // Starts the graph without blocking. The graph must not be modified or
+    // run again until it has completed; `on_complete` runs on the thread that
+    // finishes the last task.
+    void run(mailbox::IDispatcher &dispatcher, Task &&on_complete = nullptr)
+    {
+        dispatcher_ = &dispatcher;
+        on_complete_ = std::move(on_complete);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_ = nodes_.empty();
+        }
+        remaining_.store(nodes_.size());
+        for (auto &node : nodes_) {
+            node->pending.store(node->predecessors, std::memory_order_relaxed);
+        }
+        if (nodes_.empty()) {
+            complete();
+            return;
+        }
+        std::vector<TaskId> roots;
+        for (TaskId id = 0; id < nodes_.size(); ++id) {
+            if (nodes_[id]->predecessors == 0) {
+                roots.push_back(id);
+            }
+        }
+        for (auto id : roots) {
+            schedule(id);
+        }
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this]() { return done_; });
+    }
+
+private:
+    class Node
+    {
+    public:
+        Task task;
+        std::vector<TaskId> successors;
+        std::size_t predecessors{0};
+        std::atomic<std::size_t> pending{0};
+    };
+
+    void schedule(TaskId id)
+    {
+        dispatcher_->schedule([this, id]() {
+            execute(id);
+        });
+    }
+
+    // Runs a task, then keeps going with one of the successors it made ready
+    // instead of queueing it, which makes chains cost no scheduling at all.
+    void execute(TaskId id)
+    {
+        // Once remaining_ is decremented the graph may complete and be
+        // destroyed by another thread, so nothing but locals is used after.
+        const auto none = nodes_.size();
+        for (;;) {
+            auto &node = *nodes_[id];
+            node.task();
+            auto next = none;
+            for (auto successor : node.successors) {
+                if (nodes_[successor]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next == none) {
+                        next = successor;
+                    } else {
+                        schedule(successor);
+                    }
+                }
+            }
+            if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                complete();
+                return;
+            }
+            if (next == none) {
+                return;
+            }
+            id = next;
+        }
+    }
+
+    void complete()
+    {
+        auto on_complete = std::move(on_complete_);
+        {
+            // Notify under the lock: a waiter may destroy the graph as soon
+            // as it can observe done_.
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_ = true;
+            finished_.notify_all();
+        }
+        if (on_complete) {
+            on_complete();
+        }
+    }
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    mailbox::IDispatcher *dispatcher_{nullptr};
+    Task on_complete_;
+    std::atomic<std::size_t> remaining_{0};
+    std::mutex mutex_;
+    std::condition_variable finished_;
+    bool done_{true};
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_TASK_GRAPH_HPP
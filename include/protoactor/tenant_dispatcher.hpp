@@ -0,0 +1,200 @@
+#ifndef PROTOACTOR_TENANT_DISPATCHER_HPP
+#define PROTOACTOR_TENANT_DISPATCHER_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <protoactor/clock.hpp>
+#include <protoactor/mailbox.hpp>
+#include <thread>
+#include <vector>
+
+namespace protoactor
+{
+namespace mailbox
+{
+
+// One pool of workers shared by groups of actors, e.g. one group per
+// tenant, each with a weight: its share of the workers' time while several
+// groups have work. A group that has nothing to run leaves its share to the
+// others, so there is no idle capacity reserved for it as with a thread pool
+// per tenant.
+//
+// Workers pick the next mailbox by weighted fair queueing on handler time:
+// every run is timed and charged to its group as elapsed / weight of virtual
+// time, and the group with work and the least virtual time goes next. A
+// group that had nothing to run starts again from the virtual time of the
+// latest pick rather than from where it left off, so idling earns no
+// credit. Shares hold across runs, not within one; a mailbox run is at most
+// throughput() messages.
+//
+// Groups are IDispatchers for Props::with_dispatcher(); schedule hints are
+// ignored.
+class TenantDispatcher
+{
+public:
+    using Runner = std::function<void ()>;
+
+    class Group : public IDispatcher
+    {
+    public:
+        Group(TenantDispatcher &pool, double weight)
+            : pool_(pool)
+            , weight_{weight}
+        {
+        }
+
+        using IDispatcher::schedule;
+
+        virtual void schedule(const Runner &runner) override
+        {
+            pool_.push(*this, &runner, 1);
+        }
+
+        virtual void schedule_batch(const Runner *runners, const ScheduleHint *, std::size_t count) override
+        {
+            pool_.push(*this, runners, count);
+        }
+
+        virtual int throughput() const override
+        {
+            return pool_.throughput_;
+        }
+
+        // Handler time charged to the group so far, in nanoseconds.
+        std::int64_t consumed() const
+        {
+            std::unique_lock<std::mutex> lock(pool_.mutex_);
+            return consumed_;
+        }
+
+        double weight() const
+        {
+            return weight_;
+        }
+
+    private:
+        friend class TenantDispatcher;
+
+        TenantDispatcher &pool_;
+        const double weight_;
+        // Guarded by the pool's mutex, like the rest.
+        std::deque<Runner> runners_;
+        double virtual_time_{0};
+        std::int64_t consumed_{0};
+    };
+
+    TenantDispatcher(int worker_count = static_cast<int>(std::thread::hardware_concurrency()), int throughput = 300)
+        : throughput_{throughput}
+    {
+        if (worker_count < 1) {
+            worker_count = 1;
+        }
+        for (auto i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this]() {
+                work();
+            });
+        }
+    }
+
+    ~TenantDispatcher()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // The group lives as long as the dispatcher. `weight` must be positive.
+    Group &add_group(double weight)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        groups_.push_back(std::make_unique<Group>(*this, weight));
+        return *groups_.back();
+    }
+
+private:
+    void push(Group &group, const Runner *runners, std::size_t count)
+    {
+        if (count == 0) {
+            return;
+        }
+        int wake;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (group.runners_.empty()) {
+                group.virtual_time_ = std::max(group.virtual_time_, virtual_now_);
+            }
+            group.runners_.insert(group.runners_.end(), runners, runners + count);
+            wake = static_cast<int>(std::min(count, static_cast<std::size_t>(sleeping_)));
+        }
+        if (wake == 1) {
+            ready_.notify_one();
+        } else if (wake > 1) {
+            ready_.notify_all();
+        }
+    }
+
+    Group *pick() const
+    {
+        Group *next = nullptr;
+        for (auto &group : groups_) {
+            if (!group->runners_.empty() && (!next || group->virtual_time_ < next->virtual_time_)) {
+                next = group.get();
+            }
+        }
+        return next;
+    }
+
+    void work()
+    {
+        auto &clock = RuntimeClock::instance();
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            auto group = pick();
+            if (!group) {
+                if (stopping_) {
+                    return;
+                }
+                ++sleeping_;
+                ready_.wait(lock);
+                --sleeping_;
+                continue;
+            }
+            virtual_now_ = group->virtual_time_;
+            auto runner = std::move(group->runners_.front());
+            group->runners_.pop_front();
+            lock.unlock();
+            auto start = clock.precise_now();
+            runner();
+            auto elapsed = clock.precise_now() - start;
+            clock.update(start + elapsed);
+            lock.lock();
+            group->consumed_ += elapsed;
+            group->virtual_time_ += static_cast<double>(elapsed) / group->weight_;
+        }
+    }
+
+    const int throughput_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::vector<std::unique_ptr<Group>> groups_;
+    double virtual_now_{0};
+    int sleeping_{0};
+    bool stopping_{false};
+    std::vector<std::thread> workers_;
+};
+
+} // namespace mailbox
+} // namespace protoactor
+
+#endif // PROTOACTOR_TENANT_DISPATCHER_HPP
@@ -0,0 +1,450 @@
+#ifndef PROTOACTOR_THREAD_POOL_DISPATCHER_HPP
+#define PROTOACTOR_THREAD_POOL_DISPATCHER_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <protoactor/clock.hpp>
+#include <protoactor/cpu_topology.hpp>
+#include <protoactor/mailbox.hpp>
+#include <thread>
+#include <vector>
+
+namespace protoactor
+{
+namespace mailbox
+{
+
+class ThreadPoolDispatcher : public IDispatcher
+{
+public:
+    using Runner = std::function<void ()>;
+
+    // `max_linger` is the longest a mailbox that has run dry keeps polling
+    // its worker for the next message, in polls of about a pause instruction;
+    // see IDispatcher::max_linger().
+    //
+    // Mailboxes of a higher SchedulePriority run first, but a worker passes
+    // over a lower priority that has mailboxes waiting at most `aging` times
+    // in a row, so none is starved.
+    //
+    // With a topology, worker i is pinned to its i-th CPU, wrapping around,
+    // and idle workers steal from the nearest workers first; see steal().
+    // Without one all workers are equally near and run wherever the OS puts
+    // them.
+    ThreadPoolDispatcher(int worker_count = static_cast<int>(std::thread::hardware_concurrency()), int throughput = 300, int max_linger = 0, unsigned aging = 8, const CpuTopology *topology = nullptr)
+        : throughput_{throughput}
+        , max_linger_{max_linger}
+        , aging_{aging}
+    {
+        if (worker_count < 1) {
+            worker_count = 1;
+        }
+        for (auto i = 0; i < worker_count; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        place(topology);
+        for (auto i = 0; i < worker_count; ++i) {
+            workers_[i]->thread = std::thread([this, i]() {
+                work(i);
+            });
+        }
+    }
+
+    virtual ~ThreadPoolDispatcher()
+    {
+        stopping_.store(true);
+        for (auto &worker : workers_) {
+            {
+                std::unique_lock<std::mutex> lock(worker->mutex);
+            }
+            worker->ready.notify_all();
+        }
+        for (auto &worker : workers_) {
+            worker->thread.join();
+        }
+    }
+
+    virtual void schedule(const std::function<void ()> &runner) override
+    {
+        schedule(runner, ScheduleHint{});
+    }
+
+    virtual void schedule(const std::function<void ()> &runner, const ScheduleHint &hint) override
+    {
+        if (hint.worker >= 0) {
+            push(hint.worker % worker_count(), runner, true, hint.priority);
+            return;
+        }
+        auto current = current_worker();
+        if (current >= 0) {
+            push(current, runner, false, hint.priority);
+            return;
+        }
+        auto next = next_worker_.fetch_add(1, std::memory_order_relaxed) % static_cast<unsigned>(worker_count());
+        push(static_cast<int>(next), runner, false, hint.priority);
+    }
+
+    // Runners with a hint go to their pinned queues; the others are dealt
+    // out in contiguous slices over all workers, starting from a rotating
+    // one. Each worker's queue is locked once and each sleeping worker that
+    // got something is woken once.
+    virtual void schedule_batch(const Runner *runners, const ScheduleHint *hints, std::size_t count) override
+    {
+        auto workers = static_cast<std::size_t>(worker_count());
+        std::size_t unhinted = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            unhinted += hints[i].worker < 0;
+        }
+        auto first = next_worker_.fetch_add(1, std::memory_order_relaxed);
+        std::vector<std::size_t> targets(count);
+        std::vector<std::size_t> offsets(workers + 1, 0);
+        std::size_t dealt = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto worker = hints[i].worker;
+            targets[i] = worker >= 0 ? static_cast<std::size_t>(worker) % workers : (first + dealt++ * workers / unhinted) % workers;
+            ++offsets[targets[i] + 1];
+        }
+        for (std::size_t worker = 0; worker < workers; ++worker) {
+            offsets[worker + 1] += offsets[worker];
+        }
+        std::vector<std::size_t> order(count);
+        auto cursors = offsets;
+        for (std::size_t i = 0; i < count; ++i) {
+            order[cursors[targets[i]]++] = i;
+        }
+        for (std::size_t index = 0; index < workers; ++index) {
+            auto begin = offsets[index];
+            auto end = offsets[index + 1];
+            if (begin == end) {
+                continue;
+            }
+            auto &worker = *workers_[index];
+            bool notify;
+            {
+                std::unique_lock<std::mutex> lock(worker.mutex);
+                for (auto i = begin; i < end; ++i) {
+                    auto &hint = hints[order[i]];
+                    auto &lane = worker.lane(hint.priority);
+                    (hint.worker >= 0 ? lane.pinned : lane.runners).push_back(runners[order[i]]);
+                }
+                notify = worker.sleeping;
+            }
+            if (notify) {
+                worker.ready.notify_one();
+            }
+        }
+    }
+
+    virtual int throughput() const override
+    {
+        return throughput_;
+    }
+
+    virtual int max_linger() const override
+    {
+        return max_linger_;
+    }
+
+    int worker_count() const
+    {
+        return static_cast<int>(workers_.size());
+    }
+
+    // Index of the worker running the calling thread, or -1 when called from
+    // outside this dispatcher.
+    int current_worker() const
+    {
+        auto &current = current_thread();
+        return current.dispatcher == this ? current.worker : -1;
+    }
+
+private:
+    // The runners of one SchedulePriority on a worker.
+    class Lane
+    {
+    public:
+        bool empty() const
+        {
+            return runners.empty() && pinned.empty();
+        }
+
+        std::deque<Runner> runners;
+        // Runners with a worker hint, never stolen.
+        std::deque<Runner> pinned;
+        // Times in a row a higher lane went first while this one had runners.
+        unsigned passed_over{0};
+        // Whether pinned runners go next when there are both kinds.
+        bool pinned_turn{false};
+    };
+
+    // The workers at one CpuTopology::Distance from a thief, and how its
+    // steals from them went. Owned by the thief's thread.
+    class StealLevel
+    {
+    public:
+        std::vector<int> victims;
+        std::size_t cursor{0};
+        unsigned skip{0};
+        unsigned failures{0};
+    };
+
+    // Each worker owns queues it takes from in FIFO order; idle workers
+    // steal from the back of the others. Runners with a worker hint go to
+    // pinned queues that are never stolen from.
+    class Worker
+    {
+    public:
+        bool empty() const
+        {
+            for (auto &lane : lanes) {
+                if (!lane.empty()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        Lane &lane(SchedulePriority priority)
+        {
+            return lanes[static_cast<std::size_t>(priority)];
+        }
+
+        std::size_t stealable() const
+        {
+            std::size_t size = 0;
+            for (auto &lane : lanes) {
+                size += lane.runners.size();
+            }
+            return size;
+        }
+
+        std::mutex mutex;
+        std::condition_variable ready;
+        // Indexed by SchedulePriority.
+        std::array<Lane, 3> lanes;
+        bool sleeping{false};
+        bool woken{false};
+        // -1 when not pinned.
+        int cpu{-1};
+        // Indexed by CpuTopology::Distance.
+        std::array<StealLevel, CpuTopology::distance_count> levels;
+        std::thread thread;
+    };
+
+    class CurrentThread
+    {
+    public:
+        const ThreadPoolDispatcher *dispatcher{nullptr};
+        int worker{-1};
+    };
+
+    static CurrentThread &current_thread()
+    {
+        static thread_local CurrentThread _current;
+        return _current;
+    }
+
+    // The highest non-empty lane, pinned runners and stealable ones alike,
+    // unless a lower one has been passed over aging_ times; then the lowest
+    // such. Lower non-empty lanes than the one returned count being passed
+    // over once more.
+    Lane *next_lane(Worker &worker) const
+    {
+        auto &lanes = worker.lanes;
+        auto next = lanes.size();
+        for (auto priority = lanes.size(); priority-- > 0;) {
+            if (!lanes[priority].empty() && (next == lanes.size() || lanes[priority].passed_over >= aging_)) {
+                next = priority;
+            }
+        }
+        if (next == lanes.size()) {
+            return nullptr;
+        }
+        for (std::size_t priority = 0; priority < next; ++priority) {
+            if (!lanes[priority].empty()) {
+                ++lanes[priority].passed_over;
+            }
+        }
+        lanes[next].passed_over = 0;
+        return &lanes[next];
+    }
+
+    void push(int index, const Runner &runner, bool pinned, SchedulePriority priority)
+    {
+        auto &worker = *workers_[index];
+        bool notify;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            auto &lane = worker.lane(priority);
+            (pinned ? lane.pinned : lane.runners).push_back(runner);
+            notify = worker.sleeping;
+        }
+        if (notify) {
+            worker.ready.notify_one();
+        } else if (!pinned && sleepers_.load(std::memory_order_relaxed) > 0) {
+            wake_thief(index);
+        }
+    }
+
+    void place(const CpuTopology *topology)
+    {
+        auto count = worker_count();
+        auto cpu = [topology](int index) -> const CpuTopology::Cpu & {
+            auto &cpus = topology->cpus();
+            return cpus[static_cast<std::size_t>(index) % cpus.size()];
+        };
+        for (auto i = 0; i < count; ++i) {
+            auto &worker = *workers_[i];
+            if (topology) {
+                worker.cpu = cpu(i).id;
+            }
+            for (auto j = 1; j < count; ++j) {
+                auto victim = (i + j) % count;
+                auto distance = topology ? CpuTopology::distance(cpu(i), cpu(victim)) : CpuTopology::Distance::Cache;
+                worker.levels[static_cast<std::size_t>(distance)].victims.push_back(victim);
+            }
+        }
+    }
+
+    // Wakes the nearest sleeping worker, which will steal from this one.
+    void wake_thief(int except)
+    {
+        for (auto &level : workers_[except]->levels) {
+            for (auto i : level.victims) {
+                auto &worker = *workers_[i];
+                std::unique_lock<std::mutex> lock(worker.mutex);
+                if (worker.sleeping && !worker.woken) {
+                    worker.woken = true;
+                    lock.unlock();
+                    worker.ready.notify_one();
+                    return;
+                }
+            }
+        }
+    }
+
+    // Within a lane, pinned and stealable runners take turns, so that a
+    // mailbox pinned here that keeps rescheduling itself cannot starve the
+    // others, nor the other way round.
+    bool take(Worker &worker, Runner &runner)
+    {
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        auto lane = next_lane(worker);
+        if (!lane) {
+            return false;
+        }
+        auto pinned = !lane->pinned.empty() && (lane->pinned_turn || lane->runners.empty());
+        lane->pinned_turn = !pinned;
+        auto &queue = pinned ? lane->pinned : lane->runners;
+        runner = std::move(queue.front());
+        queue.pop_front();
+        return true;
+    }
+
+    // Takes from the back of the highest priority the victim has, provided
+    // it has at least `backlog` runners.
+    bool steal_from(Worker &victim, std::size_t backlog, Runner &runner)
+    {
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.stealable() < backlog) {
+            return false;
+        }
+        for (auto priority = victim.lanes.size(); priority-- > 0;) {
+            auto &queue = victim.lanes[priority].runners;
+            if (!queue.empty()) {
+                runner = std::move(queue.back());
+                queue.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Nearest workers first. The SMT siblings and the cores behind the same
+    // cache are all tried every time, as what they run is cheap to move.
+    // Farther levels are tried from a rotating start, so that thieves spread
+    // over their victims, and after a failed attempt are skipped for 1, 3,
+    // 7... of the next ones, up to 15 within the socket and 63 across
+    // sockets. A remote socket gets one probe per attempt, and only a worker
+    // with more than one runner queued is robbed across sockets, so the
+    // victim keeps the runner it is about to take.
+    bool steal(int thief, Runner &runner)
+    {
+        auto &worker = *workers_[thief];
+        for (std::size_t distance = 0; distance < CpuTopology::distance_count; ++distance) {
+            auto &level = worker.levels[distance];
+            if (level.victims.empty()) {
+                continue;
+            }
+            if (level.skip > 0) {
+                --level.skip;
+                continue;
+            }
+            auto far = distance >= static_cast<std::size_t>(CpuTopology::Distance::Socket);
+            auto remote = distance == static_cast<std::size_t>(CpuTopology::Distance::Remote);
+            auto size = level.victims.size();
+            auto first = far ? level.cursor++ : 0;
+            for (std::size_t i = 0; i < (remote ? 1 : size); ++i) {
+                if (steal_from(*workers_[level.victims[(first + i) % size]], remote ? 2 : 1, runner)) {
+                    level.failures = 0;
+                    return true;
+                }
+            }
+            if (far) {
+                level.failures = std::min(level.failures + 1, remote ? 6u : 4u);
+                level.skip = (1u << level.failures) - 1;
+            }
+        }
+        return false;
+    }
+
+    void work(int index)
+    {
+        auto &current = current_thread();
+        current.dispatcher = this;
+        current.worker = index;
+        auto &worker = *workers_[index];
+        if (worker.cpu >= 0) {
+            CpuTopology::pin_current_thread(worker.cpu);
+        }
+        auto &clock = RuntimeClock::instance();
+        for (;;) {
+            Runner runner;
+            if (take(worker, runner) || steal(index, runner)) {
+                runner();
+                clock.update();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.sleeping = true;
+            sleepers_.fetch_add(1, std::memory_order_relaxed);
+            worker.ready.wait(lock, [&]() {
+                return stopping_.load() || worker.woken || !worker.empty();
+            });
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            worker.sleeping = false;
+            worker.woken = false;
+            if (stopping_.load() && worker.empty()) {
+                return;
+            }
+        }
+    }
+
+    std::atomic<unsigned> next_worker_{0};
+    std::atomic_int sleepers_{0};
+    std::atomic_bool stopping_{false};
+    int throughput_;
+    int max_linger_;
+    unsigned aging_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+} // namespace mailbox
+} // namespace protoactor
+
+#endif // PROTOACTOR_THREAD_POOL_DISPATCHER_HPP
@@ -0,0 +1,203 @@
+#ifndef PROTOACTOR_TICK_GROUP_HPP
+#define PROTOACTOR_TICK_GROUP_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <protoactor/protoactor.hpp>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace protoactor
+{
+
+// Shared by every subscriber of a group and never deleted, like
+// StartedMessage::instance().
+class TickMessage : public Message
+{
+public:
+    TickMessage(const std::string &group, std::chrono::milliseconds period)
+        : Message{true}
+        , group{group}
+        , period{period}
+    {
+    }
+
+    const std::string group;
+    const std::chrono::milliseconds period;
+};
+
+// Named periodic ticks shared by many actors. Each group has one timer entry
+// on a single timer thread; when it fires, the group's TickMessage is posted
+// to every subscriber in one pass, with their mailboxes scheduled as one
+// batch. Subscribers are resolved once, when they
+// subscribe, and stopped ones are dropped on the next tick.
+class TickGroups
+{
+public:
+    static TickGroups &instance()
+    {
+        static TickGroups _instance;
+        return _instance;
+    }
+
+    ~TickGroups()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        changed_.notify_all();
+        if (timer_.joinable()) {
+            timer_.join();
+        }
+    }
+
+    // The period is fixed by the first subscription of a group.
+    void subscribe(const std::string &group, std::chrono::milliseconds period, const PID &pid)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto &entry = groups_[group];
+        if (!entry) {
+            entry = std::make_unique<Group>(group, period);
+            entry->next_tick = Clock::now() + period;
+        }
+        auto process = ProcessRegistry::instance().find(pid.id());
+        if (!process) {
+            return;
+        }
+        writable(*entry).push_back(Subscriber{pid, process});
+        if (!timer_.joinable()) {
+            timer_ = std::thread([this]() {
+                run();
+            });
+        }
+        lock.unlock();
+        changed_.notify_all();
+    }
+
+    void unsubscribe(const std::string &group, const PID &pid)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto iter = groups_.find(group);
+        if (groups_.end() == iter) {
+            return;
+        }
+        auto &subscribers = writable(*iter->second);
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [&](const Subscriber &subscriber) {
+            return subscriber.pid.id() == pid.id() && subscriber.pid.address() == pid.address();
+        }), subscribers.end());
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    class Subscriber
+    {
+    public:
+        PID pid;
+        std::shared_ptr<Process> process;
+    };
+
+    using Subscribers = std::vector<Subscriber>;
+
+    class Group
+    {
+    public:
+        Group(const std::string &name, std::chrono::milliseconds period)
+            : tick{name, period}
+        {
+        }
+
+        TickMessage tick;
+        Clock::time_point next_tick;
+        // Replaced rather than modified while a tick holds it, so that the
+        // tick can go out without holding the lock.
+        std::shared_ptr<Subscribers> subscribers{std::make_shared<Subscribers>()};
+    };
+
+    TickGroups() = default;
+
+    // Called with the lock held. Only the timer thread shares the list, and
+    // it takes its reference under the lock too, so a list nobody else holds
+    // can be changed in place instead of being copied for every subscriber.
+    static Subscribers &writable(Group &group)
+    {
+        if (group.subscribers.use_count() != 1) {
+            group.subscribers = std::make_shared<Subscribers>(*group.subscribers);
+        }
+        return *group.subscribers;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            auto now = Clock::now();
+            auto next = now + std::chrono::hours(1);
+            std::vector<std::pair<Group *, std::shared_ptr<Subscribers>>> due;
+            for (auto &entry : groups_) {
+                auto &group = *entry.second;
+                if (group.next_tick <= now) {
+                    due.emplace_back(&group, group.subscribers);
+                    do {
+                        group.next_tick += group.tick.period;
+                    } while (group.next_tick <= now);
+                }
+                next = std::min(next, group.next_tick);
+            }
+            if (!due.empty()) {
+                lock.unlock();
+                auto stopped = tick(due);
+                lock.lock();
+                if (stopped) {
+                    prune();
+                }
+                continue;
+            }
+            changed_.wait_until(lock, next);
+        }
+    }
+
+    bool tick(const std::vector<std::pair<Group *, std::shared_ptr<Subscribers>>> &due)
+    {
+        auto stopped = false;
+        ScheduleBatch batch;
+        for (auto &group : due) {
+            for (auto &subscriber : *group.second) {
+                auto local = dynamic_cast<LocalProcess *>(subscriber.process.get());
+                if (local && local->is_dead()) {
+                    stopped = true;
+                    continue;
+                }
+                subscriber.process->send_user_message(const_cast<PID *>(&subscriber.pid), Message::UPtr{&group.first->tick});
+            }
+        }
+        return stopped;
+    }
+
+    void prune()
+    {
+        for (auto &entry : groups_) {
+            auto &subscribers = writable(*entry.second);
+            subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [](const Subscriber &subscriber) {
+                auto local = dynamic_cast<LocalProcess *>(subscriber.process.get());
+                return local && local->is_dead();
+            }), subscribers.end());
+        }
+    }
+
+    std::unordered_map<std::string, std::unique_ptr<Group>> groups_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_{false};
+    std::thread timer_;
+};
+
+} // namespace protoactor
+
+#endif // PROTOACTOR_TICK_GROUP_HPP
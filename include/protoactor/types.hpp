@@ -1,11 +1,33 @@
 #ifndef PROTOACTOR_TYPES_HPP
 #define PROTOACTOR_TYPES_HPP
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <memory>
+#include <utility>
+
+// Defined, or implied by building with -fno-exceptions, to keep the runtime
+// free of exceptions: handlers fail through IActor::try_receive, a taken
+// actor name makes spawning return nullptr, and what would otherwise throw
+// aborts.
+#if !defined(PROTOACTOR_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS)
+#define PROTOACTOR_NO_EXCEPTIONS 1
+#endif
+
+#ifdef PROTOACTOR_NO_EXCEPTIONS
+#define PROTOACTOR_THROW(exception) std::abort()
+#else
+#define PROTOACTOR_THROW(exception) throw exception
+#endif
 
 namespace protoactor
 {
 
+class PID;
+class Process;
+
 class Message
 {
 public:
@@ -37,6 +59,189 @@ private:
     const bool do_not_delete_;
 };
 
+// Who sent a message. A copy of the sender's PID and a reference to its
+// process live here, so a message may outlive the actor that sent it; one
+// Sender is shared by everything an actor sends.
+//
+// Counted intrusively, so that mailbox slots can carry it as a plain pointer.
+class Sender
+{
+public:
+    virtual ~Sender() = default;
+
+    virtual const PID &pid() const = 0;
+    // Held by the sender, so valid for as long as it is; nullptr when the
+    // sender has no process.
+    virtual Process *process() const = 0;
+
+    // Never shared by two senders, unlike the address of a Sender.
+    std::uint64_t id() const { return id_; }
+
+protected:
+    Sender()
+    {
+        renew_id();
+    }
+
+    // For a Sender reused for another actor.
+    void renew_id()
+    {
+        id_ = sequence().fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+private:
+    friend class SenderRef;
+
+    static std::atomic<std::uint64_t> &sequence()
+    {
+        static std::atomic<std::uint64_t> _sequence{0};
+        return _sequence;
+    }
+
+    std::atomic<std::size_t> references_{0};
+    std::uint64_t id_;
+};
+
+class SenderRef
+{
+public:
+    SenderRef() = default;
+
+    explicit SenderRef(Sender *sender)
+        : sender_{sender}
+    {
+        retain();
+    }
+
+    SenderRef(const SenderRef &other)
+        : sender_{other.sender_}
+    {
+        retain();
+    }
+
+    SenderRef(SenderRef &&other)
+        : sender_{other.release()}
+    {
+    }
+
+    ~SenderRef()
+    {
+        reset();
+    }
+
+    SenderRef &operator=(const SenderRef &other)
+    {
+        SenderRef{other}.swap(*this);
+        return *this;
+    }
+
+    SenderRef &operator=(SenderRef &&other)
+    {
+        SenderRef{std::move(other)}.swap(*this);
+        return *this;
+    }
+
+    // Takes over a reference given up by release().
+    static SenderRef adopt(Sender *sender)
+    {
+        SenderRef ref;
+        ref.sender_ = sender;
+        return ref;
+    }
+
+    Sender *release()
+    {
+        auto sender = sender_;
+        sender_ = nullptr;
+        return sender;
+    }
+
+    void reset()
+    {
+        if (sender_ && sender_->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete sender_;
+        }
+        sender_ = nullptr;
+    }
+
+    void swap(SenderRef &other)
+    {
+        std::swap(sender_, other.sender_);
+    }
+
+    // True when this is the only reference.
+    bool unique() const
+    {
+        return sender_ && sender_->references_.load(std::memory_order_acquire) == 1;
+    }
+
+    Sender *get() const { return sender_; }
+    Sender *operator->() const { return sender_; }
+    Sender &operator*() const { return *sender_; }
+    explicit operator bool() const { return sender_ != nullptr; }
+
+private:
+    void retain()
+    {
+        if (sender_) {
+            sender_->references_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Sender *sender_{nullptr};
+};
+
+// Optional metadata stored next to a message in the mailbox slot. A
+// default-constructed header means "absent".
+class MessageHeader
+{
+public:
+    SenderRef sender;
+    std::uint64_t trace_id{0};
+    std::int64_t deadline{0};
+};
+
+// Success, or failure with a reason. The reason is not copied: it must be a
+// string literal or outlive the Status.
+class Status
+{
+public:
+    Status() = default;
+
+    explicit Status(const char *reason)
+        : reason_{reason}
+    {
+    }
+
+    explicit operator bool() const { return !reason_; }
+    const char *reason() const { return reason_; }
+
+private:
+    const char *reason_{nullptr};
+};
+
+class MessageEnvelope
+{
+public:
+    MessageEnvelope() = default;
+
+    MessageEnvelope(Message::UPtr message)
+        : message{std::move(message)}
+    {
+    }
+
+    MessageEnvelope(Message::UPtr message, const MessageHeader &header)
+        : message{std::move(message)}
+        , header(header)
+    {
+    }
+
+    explicit operator bool() const { return static_cast<bool>(message); }
+
+    Message::UPtr message;
+    MessageHeader header;
+};
+
 } // namespace protoactor
 
 #endif // PROTOACTOR_TYPES_HPP
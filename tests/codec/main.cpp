@@ -0,0 +1,223 @@
+// Round trips and malformed input for the codecs in protoactor/codec.hpp.
+//
+// Encodes values of every byte length, in runs and mixed, and checks that
+// they decode back, with the dispatching decoders (SSE4.1/SSSE3 where the CPU
+// has them) and the scalar ones. Then decodes random and mutated buffers with
+// both and checks that they accept and reject the same input, stop at the
+// same byte and produce the same values. Exits non-zero on any mismatch.
+//
+// usage: codec_test [iterations] [seed]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <protoactor/codec.hpp>
+#include <string>
+#include <vector>
+
+using namespace protoactor::codec;
+
+namespace
+{
+
+int failures = 0;
+
+void fail(const std::string &what, std::uint64_t iteration)
+{
+    if (++failures <= 10) {
+        std::cerr << what << " (iteration " << iteration << ")" << std::endl;
+    }
+}
+
+class Rng
+{
+public:
+    explicit Rng(std::uint64_t seed)
+        : state_{seed}
+    {
+    }
+
+    std::uint64_t next()
+    {
+        // splitmix64
+        auto z = (state_ += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    std::size_t below(std::size_t bound)
+    {
+        return static_cast<std::size_t>(next() % bound);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+// Mostly short values, with runs of one length so that every decoder fast
+// path sees whole windows of it.
+std::vector<std::uint32_t> make_values(Rng &rng, std::size_t count)
+{
+    std::vector<std::uint32_t> values(count);
+    auto bits = 1 + rng.below(32);
+    for (auto &value : values) {
+        if (rng.below(8) == 0) {
+            bits = 1 + rng.below(32);
+        }
+        auto random = static_cast<std::uint32_t>(rng.next());
+        value = bits == 32 ? random : random & ((1u << bits) - 1);
+    }
+    return values;
+}
+
+template <typename TDecode, typename TScalarDecode>
+void check_round_trip(const std::string &codec, const std::vector<std::uint32_t> &values, const std::vector<std::uint8_t> &encoded, std::size_t size, TDecode &&decode, TScalarDecode &&decode_scalar, std::uint64_t iteration)
+{
+    auto in = encoded.data();
+    auto end = in + size;
+    std::vector<std::uint32_t> decoded(values.size());
+    if (decode(in, end, decoded.data(), decoded.size()) != end || decoded != values) {
+        fail(codec + ": round trip mismatch", iteration);
+    }
+    std::vector<std::uint32_t> scalar(values.size());
+    if (decode_scalar(in, end, scalar.data(), scalar.size()) != end || scalar != values) {
+        fail(codec + ": scalar round trip mismatch", iteration);
+    }
+}
+
+void round_trips(Rng &rng, std::uint64_t iteration)
+{
+    auto values = make_values(rng, rng.below(300));
+    std::vector<std::uint8_t> encoded(Varint::max_size(values.size()) + GroupVarint::max_size(values.size()));
+
+    auto size = static_cast<std::size_t>(Varint::encode(values.data(), values.size(), encoded.data()) - encoded.data());
+    std::vector<std::uint8_t> scalar(encoded.size());
+    auto scalar_size = static_cast<std::size_t>(Varint::encode_scalar(values.data(), values.size(), scalar.data()) - scalar.data());
+    if (size != scalar_size || !std::equal(encoded.begin(), encoded.begin() + static_cast<std::ptrdiff_t>(size), scalar.begin())) {
+        fail("varint: encoders disagree", iteration);
+    }
+    check_round_trip("varint", values, encoded, size, [](const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *out, std::size_t count) {
+        return Varint::decode(in, end, out, count);
+    }, &Varint::decode_scalar, iteration);
+
+    size = static_cast<std::size_t>(GroupVarint::encode(values.data(), values.size(), encoded.data()) - encoded.data());
+    check_round_trip("group_varint", values, encoded, size, &GroupVarint::decode, &GroupVarint::decode_scalar, iteration);
+
+    auto value = rng.next() >> rng.below(64);
+    std::uint8_t single[10];
+    std::uint64_t decoded = 0;
+    auto single_end = Varint::encode(value, single);
+    if (Varint::decode(single, single_end, decoded) != single_end || decoded != value) {
+        fail("varint: 64-bit round trip mismatch", iteration);
+    }
+}
+
+// Random bytes biased towards continuation bits, or a valid encoding with a
+// few bytes flipped and possibly cut short.
+std::vector<std::uint8_t> make_malformed(Rng &rng)
+{
+    std::vector<std::uint8_t> bytes;
+    if (rng.below(2) == 0) {
+        bytes.resize(rng.below(200));
+        for (auto &byte : bytes) {
+            byte = static_cast<std::uint8_t>(rng.next());
+            if (rng.below(2) == 0) {
+                byte |= 0x80;
+            }
+        }
+        return bytes;
+    }
+    auto values = make_values(rng, 1 + rng.below(100));
+    bytes.resize(Varint::max_size(values.size()));
+    bytes.resize(static_cast<std::size_t>(Varint::encode_scalar(values.data(), values.size(), bytes.data()) - bytes.data()));
+    for (auto flips = rng.below(4); flips > 0; --flips) {
+        bytes[rng.below(bytes.size())] ^= static_cast<std::uint8_t>(1u << rng.below(8));
+    }
+    if (rng.below(4) == 0) {
+        bytes.resize(rng.below(bytes.size() + 1));
+    }
+    return bytes;
+}
+
+template <typename TDecode, typename TScalarDecode>
+void check_agreement(const std::string &codec, const std::vector<std::uint8_t> &bytes, std::size_t count, TDecode &&decode, TScalarDecode &&decode_scalar, std::uint64_t iteration)
+{
+    auto in = bytes.data();
+    auto end = in + bytes.size();
+    std::vector<std::uint32_t> values(count);
+    std::vector<std::uint32_t> scalar(count);
+    auto decoded = decode(in, end, values.data(), count);
+    auto scalar_decoded = decode_scalar(in, end, scalar.data(), count);
+    if (decoded != scalar_decoded) {
+        fail(codec + ": decoders disagree on malformed input", iteration);
+    } else if (decoded && values != scalar) {
+        fail(codec + ": decoders disagree on values", iteration);
+    }
+}
+
+void malformed(Rng &rng, std::uint64_t iteration)
+{
+    auto bytes = make_malformed(rng);
+    auto count = rng.below(bytes.size() + 2);
+    check_agreement("varint", bytes, count, [](const std::uint8_t *in, const std::uint8_t *end, std::uint32_t *out, std::size_t n) {
+        return Varint::decode(in, end, out, n);
+    }, &Varint::decode_scalar, iteration);
+    check_agreement("group_varint", bytes, count, &GroupVarint::decode, &GroupVarint::decode_scalar, iteration);
+}
+
+// The edges of the 32- and 64-bit decoders.
+void edges()
+{
+    const std::uint8_t five_bytes_max[] = {0xff, 0xff, 0xff, 0xff, 0x0f};
+    const std::uint8_t five_bytes_over[] = {0xff, 0xff, 0xff, 0xff, 0x10};
+    const std::uint8_t six_bytes_zero[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    const std::uint8_t ten_bytes_max[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01};
+    const std::uint8_t ten_bytes_over[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02};
+    const std::uint8_t eleven_bytes[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    std::uint32_t value32 = 0;
+    std::uint64_t value64 = 0;
+    if (Varint::decode_scalar(five_bytes_max, five_bytes_max + 5, &value32, 1) != five_bytes_max + 5 || value32 != std::numeric_limits<std::uint32_t>::max()) {
+        fail("varint: largest 32-bit value rejected", 0);
+    }
+    if (Varint::decode_scalar(five_bytes_over, five_bytes_over + 5, &value32, 1)) {
+        fail("varint: 32-bit overflow accepted", 0);
+    }
+    if (Varint::decode_scalar(six_bytes_zero, six_bytes_zero + 6, &value32, 1)) {
+        fail("varint: six-byte 32-bit encoding accepted", 0);
+    }
+    if (Varint::decode(ten_bytes_max, ten_bytes_max + 10, value64) != ten_bytes_max + 10 || value64 != std::numeric_limits<std::uint64_t>::max()) {
+        fail("varint: largest 64-bit value rejected", 0);
+    }
+    if (Varint::decode(ten_bytes_over, ten_bytes_over + 10, value64)) {
+        fail("varint: 64-bit overflow accepted", 0);
+    }
+    if (Varint::decode(eleven_bytes, eleven_bytes + 11, value64)) {
+        fail("varint: eleven-byte encoding accepted", 0);
+    }
+    if (Varint::decode(ten_bytes_max, ten_bytes_max + 9, value64)) {
+        fail("varint: truncated encoding accepted", 0);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    auto iterations = static_cast<std::uint64_t>(argc > 1 ? std::atoll(argv[1]) : 100000);
+    Rng rng(argc > 2 ? static_cast<std::uint64_t>(std::atoll(argv[2])) : 1);
+
+    edges();
+    for (std::uint64_t iteration = 0; iteration < iterations; ++iteration) {
+        round_trips(rng, iteration);
+        malformed(rng, iteration);
+    }
+    if (failures) {
+        std::cerr << failures << " failures" << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}